@@ -0,0 +1,412 @@
+#include "../simulator/reconstruct.hpp"
+#include "../simulator/helper/filter.hpp"
+// -DBENCH_INSTANTIATE: build against the precompiled instantiations (link with instantiate.o, see bench/README.md),
+// so that both builds can be compared
+#ifdef BENCH_INSTANTIATE
+#include "../simulator/instantiate.hpp"
+#endif
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace GaussSim;
+
+using std::string;
+
+// microbenchmarks of the hot paths of the simulator
+//
+// ./bench [filter=<substring>] [time=<seconds>] [baseline=<file>] [save=<file>] [tolerance=<ratio>]
+//   filter:    run only the benchmarks whose names contain the substring
+//   time:      the minimum time spent on each benchmark (default 0.2), the fastest repetition is reported
+//   baseline:  compare with a baseline file (written by save=) and exit with 1 if any benchmark is slower by more than tolerance
+//   save:      write the results as a baseline file ("<name> <ns/step>" per line)
+//   tolerance: the allowed slowdown against the baseline (default 0.25, i.e. 25%)
+//
+// a "step" is one iteration of the map (orbit, continuedFraction, frequency*, reconstruct), one evaluation of the integrant,
+// one product (one point for the batch product), or one filtered value
+
+struct BenchResult
+{
+    string name;
+    double nsPerStep;
+};
+
+struct BenchOptions
+{
+    string filter = "";
+    double seconds = 0.2;
+    string baseline = "";
+    string save = "";
+    double tolerance = 0.25;
+};
+
+BenchOptions options;
+vector<BenchResult> results;
+
+// the results of the benchmarks are added to sink, so that the compiler cannot drop the computations
+double sink = 0;
+
+// run body (which does steps steps and returns a value depending on all of them) repeatedly for options.seconds
+template <typename Body>
+void bench(const string &name, size_t steps, Body body)
+{
+    using clock = std::chrono::steady_clock;
+
+    if (!options.filter.empty() && name.find(options.filter) == string::npos)
+        return;
+
+    double best = INFINITY, elapsed = 0, seconds;
+    clock::time_point start;
+
+    sink += body(); // warm up
+    do
+    {
+        start = clock::now();
+        sink += body();
+        seconds = std::chrono::duration<double>(clock::now() - start).count();
+        best = std::min(best, seconds);
+        elapsed += seconds;
+    } while (elapsed < options.seconds);
+
+    results.push_back({name, best * 1e9 / steps});
+    std::cout << std::left << std::setw(44) << name << std::right
+              << std::setw(14) << std::setprecision(4) << steps / best << " steps/s"
+              << std::setw(12) << std::setprecision(4) << best * 1e9 / steps << " ns/step" << std::endl;
+}
+
+template <size_t n>
+string suffix(const string &map)
+{
+    return "/" + map + "/n=" + std::to_string(n);
+}
+
+template <size_t n>
+Torus<double, n> somePoint(double seed)
+{
+    array<double, n> x;
+    size_t i;
+
+    for (i = 0; i < n; ++i)
+    {
+        x[i] = std::fmod(seed * (i + 1) * 0.7548776662466927, 1.0);
+    }
+
+    return Torus<double, n>(x);
+}
+
+// orbit, continuedFraction, frequencyOfOrbit, frequencyOfRandomOrbits of the generalized gauss transformation of map
+template <size_t n, typename F>
+void benchMap(const string &map, F original)
+{
+    const size_t depth = 100000;
+    const size_t randomDepth = 1000, numOfExperiments = 64;
+    auto ggt = makeStaticGGT<double, n>(original);
+    Torus<double, n> bl, tr;
+    size_t i;
+
+    for (i = 0; i < n; ++i)
+    {
+        bl.coordinate[i] = 0.2;
+        tr.coordinate[i] = 0.6;
+    }
+
+    bench("orbit" + suffix<n>(map), depth, [&]()
+          { return ggt.orbit(somePoint<n>(0.3), depth).back()[0]; });
+    // the same orbit through GGT (the map behind std::function)
+    GGT<double, n> dynamicGGT(original);
+    bench("GGT::orbit" + suffix<n>(map), depth, [&]()
+          { return dynamicGGT.orbit(somePoint<n>(0.3), depth).back()[0]; });
+    bench("continuedFraction" + suffix<n>(map), depth, [&]()
+          { return (double)ggt.continuedFraction(somePoint<n>(0.3), depth).back()[0]; });
+    bench("frequencyOfOrbit" + suffix<n>(map), depth, [&]()
+          { return ggt.frequencyOfOrbit(bl, tr, somePoint<n>(0.3), depth); });
+    bench("frequencyOfRandomOrbits" + suffix<n>(map), randomDepth * numOfExperiments, [&]()
+          { return ggt.frequencyOfRandomOrbits(bl, tr, randomDepth, numOfExperiments); });
+}
+
+// x -> 1 / x (the normal gauss transformation)
+template <size_t n>
+array<double, n> inverse(array<double, n> x)
+{
+    return INVERSE<double, n>(x);
+}
+
+// x -> x^{-p} (coordinatewise, xp_simulate for n = 1)
+template <size_t n>
+array<double, n> power(array<double, n> x)
+{
+    const double p = 0.8;
+    array<double, n> y;
+    size_t i;
+
+    for (i = 0; i < n; ++i)
+    {
+        y[i] = (x[i] == 0) ? 0 : std::pow(x[i], -p);
+    }
+
+    return y;
+}
+
+// x -> (phi(x), psi(x)) of md_gauss
+array<double, 2> phiPsi(array<double, 2> x)
+{
+    const double p = 0.52, q = 0.48, r = 0.45, s = 0.55;
+
+    if (x[0] * x[1] == 0)
+        return array<double, 2>{0, 0};
+    return array<double, 2>{1 / (std::pow(x[0], p) * std::pow(x[1], q)),
+                            1 / (std::pow(x[0], r) * std::pow(x[1], s))};
+}
+
+template <size_t n>
+void benchReconstruct()
+{
+    const size_t depth = 40, numOfValues = 1000;
+    ReconstructGGT<double, n> ggt(inverse<n>, inverse<n>);
+    vector<Torus<double, n>> values;
+    size_t k;
+
+    for (k = 0; k < numOfValues; ++k)
+    {
+        values.push_back(somePoint<n>(k + 0.5));
+    }
+
+    bench("reconstruct" + suffix<n>("INVERSE"), depth * numOfValues, [&]()
+          {
+        double sum = 0;
+        for (const auto &value : values)
+            sum += ggt.reconstruct(value, depth)[0];
+        return sum; });
+}
+
+template <size_t n>
+void benchIntegral()
+{
+    // about 10^5 cells
+    const size_t N = (size_t)std::round(std::pow(1e5, 1.0 / n));
+    size_t cells = 1, i;
+    Torus<double, n> a, b;
+
+    for (i = 0; i < n; ++i)
+    {
+        cells *= N;
+        a.coordinate[i] = 0.1;
+        b.coordinate[i] = 0.9;
+    }
+
+    bench("Torus::integral/n=" + std::to_string(n), cells, [&]()
+          { return Torus<double, n>::integral([](Torus<double, n> x)
+                                              {
+                double value = 1;
+                size_t j;
+                for (j = 0; j < n; ++j)
+                    value *= std::sin(3 * x[j]) + 2;
+                return value; },
+                                              a, b, N); });
+
+    // the same integrant evaluated on the midpoints of a chunk at once
+    bench("Torus::integral(batch)/n=" + std::to_string(n), cells, [&]()
+          { return Torus<double, n>::integral([](const TorusBatch<double, n> &x)
+                                              {
+                vector<double> values(x.size(), 1);
+                size_t j, k;
+                for (j = 0; j < n; ++j)
+                    for (k = 0; k < x.size(); ++k)
+                        values[k] *= std::sin(3 * x.lanes[j][k]) + 2;
+                return values; },
+                                              a, b, N); });
+}
+
+template <size_t n>
+void benchMatrix()
+{
+    const size_t numOfProducts = 100000, numOfPoints = 100000;
+    Matrix<int, n, n> A = Matrix<int, n, n>::identity(), B = Matrix<int, n, n>::identity();
+    Matrix<double, n, n> C = Matrix<double, n, n>::identity();
+    TorusBatch<double, n> batch(numOfPoints);
+    size_t i, j, k;
+
+    for (i = 0; i < n; ++i)
+    {
+        for (j = 0; j < n; ++j)
+        {
+            A.entries[i][j] = (int)(i + 2 * j + 1) % 3;
+            B.entries[i][j] = (int)(2 * i + j) % 3 - 1;
+            C.entries[i][j] = 0.25 * (i + j) + (i == j);
+        }
+    }
+    for (k = 0; k < numOfPoints; ++k)
+    {
+        batch.set(k, somePoint<n>(k + 0.5));
+    }
+
+    bench("Matrix*Matrix/n=" + std::to_string(n), numOfProducts, [&]()
+          {
+        Matrix<int, n, n> P = A, Q = A;
+        size_t t;
+        // each product depends on the previous one (the entries stay small)
+        for (t = 0; t < numOfProducts; ++t)
+        {
+            P = Q * B;
+            Q.entries[0][0] = P.entries[n - 1][n - 1] % 5;
+        }
+        return (double)P.entries[0][0]; });
+    bench("Matrix*array/n=" + std::to_string(n), numOfProducts, [&]()
+          {
+        array<double, n> x;
+        size_t t, l;
+        x.fill(0.5);
+        for (t = 0; t < numOfProducts; ++t)
+        {
+            x = C * x;
+            for (l = 0; l < n; ++l)
+                x[l] = mod1(x[l]);
+        }
+        return x[0]; });
+    bench("Matrix*TorusBatch/n=" + std::to_string(n), numOfPoints, [&]()
+          { return (double)(A * batch).get(numOfPoints / 2)[0]; });
+}
+
+void benchFilter()
+{
+    const size_t length = 1000000, rows = 1000, cols = 1000;
+    vector<double> data(length);
+    size_t k;
+
+    for (k = 0; k < length; ++k)
+    {
+        data[k] = std::sin(0.001 * k) + 0.1 * std::fmod(k * 0.7548776662466927, 1.0);
+    }
+
+    const auto &smoothing = helper::filter::collection::SmoothingFilter7;
+    const auto gaussian = helper::filter::collection::gaussianFilter(20); // 161 taps, by fft
+
+    bench("LIPFilter1D::applyFilter/7taps", length, [&]()
+          { return smoothing.applyFilter(data)[length / 2]; });
+    bench("LIPFilter1D::applyFilter/gaussian20", length, [&]()
+          { return gaussian.applyFilter(data)[length / 2]; });
+    bench("LIPFilter1D::applyFilterToColumns/7taps", rows * cols, [&]()
+          { return smoothing.applyFilterToColumns(data, rows, cols)[length / 2]; });
+}
+
+// name -> ns/step
+std::map<string, double> readBaseline(const string &path)
+{
+    std::map<string, double> baseline;
+    std::ifstream in(path);
+    string line, name;
+    double nsPerStep;
+
+    if (!in)
+        throw std::runtime_error("cannot open the baseline " + path);
+
+    while (std::getline(in, line))
+    {
+        if (line.empty() || line[0] == '#')
+            continue;
+        std::istringstream fields(line);
+        if (fields >> name >> nsPerStep)
+            baseline[name] = nsPerStep;
+    }
+
+    return baseline;
+}
+
+void parseOptions(int argc, char *argv[])
+{
+    int i;
+
+    for (i = 1; i < argc; ++i)
+    {
+        const string arg = argv[i];
+        const size_t eq = arg.find('=');
+        const string key = arg.substr(0, eq), value = (eq == string::npos) ? "" : arg.substr(eq + 1);
+
+        if (key == "filter")
+            options.filter = value;
+        else if (key == "time")
+            options.seconds = std::stod(value);
+        else if (key == "baseline")
+            options.baseline = value;
+        else if (key == "save")
+            options.save = value;
+        else if (key == "tolerance")
+            options.tolerance = std::stod(value);
+        else
+            std::cout << i << "-th argument is invalid: " << arg << std::endl;
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    parseOptions(argc, argv);
+
+    benchMap<1>("INVERSE", inverse<1>);
+    benchMap<2>("INVERSE", inverse<2>);
+    benchMap<3>("INVERSE", inverse<3>);
+    benchMap<1>("x^-p", power<1>);
+    benchMap<2>("x^-p", power<2>);
+    benchMap<3>("x^-p", power<3>);
+    benchMap<2>("phi,psi", phiPsi);
+
+    benchReconstruct<1>();
+    benchReconstruct<2>();
+    benchReconstruct<3>();
+
+    benchIntegral<1>();
+    benchIntegral<2>();
+    benchIntegral<3>();
+
+    benchMatrix<1>();
+    benchMatrix<2>();
+    benchMatrix<3>();
+
+    benchFilter();
+
+    if (sink == 0.123456789)
+        std::cout << "" << std::endl;
+
+    if (!options.save.empty())
+    {
+        std::ofstream out(options.save);
+        out << "# <name> <ns/step>" << std::endl;
+        for (const auto &result : results)
+            out << result.name << " " << std::setprecision(6) << result.nsPerStep << std::endl;
+    }
+
+    if (options.baseline.empty())
+        return 0;
+
+    // compare with the baseline
+
+    const auto baseline = readBaseline(options.baseline);
+    size_t numOfRegressions = 0;
+
+    std::cout << std::endl
+              << "against " << options.baseline << " (tolerance " << options.tolerance * 100 << "%):" << std::endl;
+    for (const auto &result : results)
+    {
+        const auto found = baseline.find(result.name);
+        if (found == baseline.end())
+        {
+            std::cout << std::left << std::setw(44) << result.name << "   (not in the baseline)" << std::endl;
+            continue;
+        }
+
+        const double ratio = result.nsPerStep / found->second;
+        const bool regressed = ratio > 1 + options.tolerance;
+        numOfRegressions += regressed;
+        std::cout << std::left << std::setw(44) << result.name << std::right << std::setw(10) << std::setprecision(3) << ratio << "x"
+                  << (regressed ? "   REGRESSION" : "") << std::endl;
+    }
+
+    return numOfRegressions == 0 ? 0 : 1;
+}
@@ -1,9 +1,16 @@
 #include "../simulator/reconstruct.hpp"
+#include "../simulator/density.hpp"
+#include "../simulator/helper/checkpoint.hpp"
+#include "../simulator/shard.hpp"
 #include <iostream>
 #include <cmath>
-#include <random>
+#include <algorithm>
 
+// plotting is optional: without OpenADAPT only the density result (filename.gsd) is written
+#if __has_include(<OpenADAPT/Plot/Canvas.h>)
 #include <OpenADAPT/Plot/Canvas.h>
+#define GAUSSSIM_PLOT
+#endif
 
 using namespace GaussSim;
 
@@ -22,10 +29,15 @@ double psi(array<double, 2> x)
     return 1 / (std::pow(x[0], r) * std::pow(x[1], s));
 }
 
-// ./md_gauss p q r s filename
+// ./md_gauss p q r s filename checkpoint shard seed
+// shard = index/count runs the index-th of count parts of the experiments, and writes filename.seed-<seed>.shard-<index>of<count>.gsd
+// (the merged results of all the shards (./merge) are the result of the whole run with the same seed)
 int main(int argc, char *argv[])
 {
     std::string filename = "md_gauss_cm";
+    std::string checkpointPath = "";
+    Shard shard;
+    std::uint64_t seed = 0;
     if (argc >= 5)
     {
         p = std::stod(argv[1]);
@@ -37,9 +49,21 @@ int main(int argc, char *argv[])
     {
         filename = argv[5];
     }
+    if (argc >= 7)
+    {
+        checkpointPath = argv[6];
+    }
+    if (argc >= 8)
+    {
+        shard = Shard::parse(argv[7]);
+    }
+    if (argc >= 9)
+    {
+        seed = std::stoull(argv[8]);
+    }
 
-    GGT<double, 2> GT2D(
-        [&](array<double, 2> x) -> array<double, 2>
+    auto GT2D = makeStaticGGT<double, 2>(
+        [](array<double, 2> x) -> array<double, 2>
         {
             return array<double, 2>{phi(x), psi(x)};
         });
@@ -49,57 +73,74 @@ int main(int argc, char *argv[])
     const size_t numOfIteration = 100000;
     const size_t numOfExperiments = 10;
 
-    int i, j, k;
+    int k;
+    size_t c;
+
+    // (-DGAUSSSIM_INSTRUMENT: a summary of the run and of each experiment is printed to stderr)
+    GAUSSSIM_INSTRUMENT_RUN("md_gauss");
 
     double expectedArea, calculatedArea;
-    double btm, lft, top, rit;
-    Torus<double, 2> bl, tr;
 
-    std::random_device seed;
-    std::mt19937_64 mt(seed());
-    std::uniform_real_distribution<double> ud(0, 1);
+    // the counts of the cells (flattened) and the number of experiments of the shard are kept in a checkpoint,
+    // so that an interrupted run is resumed (bit-exactly) by running it again with the same checkpoint
 
-    adapt::Matrix<double> calcedPDF(numOfPartition, numOfPartition);
-    for (i = 0; i < numOfPartition; ++i)
+    helper::checkpoint::ExperimentState state;
+    helper::checkpoint::Checkpointer checkpointer(checkpointPath);
+
+    // (the same parameters as the results of sweep.cpp, so that they can be merged)
+    const std::string parameters = "md_gauss p=" + std::to_string(p) + " q=" + std::to_string(q) + " r=" + std::to_string(r) + " s=" + std::to_string(s) +
+                                   " N=" + std::to_string(numOfPartition) + " itr=" + std::to_string(numOfIteration / numOfPartition);
+    const std::string name = filename + (shard.whole() ? "" : ".seed-" + std::to_string(seed) + ".shard-" + shard.name());
+
+    state.config = parameters + " seed=" + std::to_string(seed) + " shard=" + shard.name() + " counts";
+    state.accumulator.assign(numOfPartition * numOfPartition, 0);
+    if (checkpointer.resume(state))
+        std::cout << "resumed from " << checkpointPath << " after " << state.numOfExperiments << " experiments" << std::endl;
+
+    vector<double> &countSum = state.accumulator; // integers, exact as doubles
+    const int first = shard.first(numOfExperiments), last = shard.last(numOfExperiments);
+
+    // experiment (the k-th experiment draws from randomStream(seed, k))
+    // the experiments run in parallel in blocks of one experiment per thread, and the checkpoint is updated after every block
+    // degenerate orbits (falling into (0, 0) etc.) are restarted from fresh points
+
+    DensityEstimator estimator(GT2D, array<size_t, 2>{numOfPartition, numOfPartition}, numOfIteration, seed);
+    const int blockSize = estimator.concurrency();
+
+    for (k = first + state.numOfExperiments; k < last; k += blockSize)
     {
-        for (j = 0; j < numOfPartition; ++j)
+        const int end = std::min(k + blockSize, last);
+        auto hist = estimator.estimate(k, end);
+        for (c = 0; c < numOfPartition * numOfPartition; ++c)
         {
-            calcedPDF[i][j] = 0;
+            countSum[c] += hist.getCounts()[c];
         }
+
+        state.numOfExperiments = end - first;
+        checkpointer.update(state);
     }
+    checkpointer.save(state);
 
-    // experiment
+    // save the raw result (see expr/plot.cpp and expr/merge.cpp to plot or merge results)
+
+    DensityResult<2> result(Histogram<2>(array<size_t, 2>{numOfPartition, numOfPartition}, vector<size_t>(countSum.begin(), countSum.end())),
+                            state.numOfExperiments, parameters, seed, first, numOfExperiments);
+    result.save(name + ".gsd");
+
+    // plot
 
-    for (k = 0; k < numOfExperiments; ++k)
+#ifdef GAUSSSIM_PLOT
+    adapt::Matrix<double> calcedPDF(numOfPartition, numOfPartition);
+    size_t i, j;
+    for (i = 0; i < numOfPartition; ++i)
     {
-    REDO:
-        auto orbit = GT2D.orbit(array<double, 2>{ud(mt), ud(mt)}, numOfIteration);
-        if (orbit[numOfIteration - 1][0] == 0 || orbit[numOfIteration - 1][1] == 0)
-            goto REDO;
-#pragma omp parallel for private(btm, lft, top, rit, bl, tr)
-        for (i = 0; i < numOfPartition; ++i)
+        for (j = 0; j < numOfPartition; ++j)
         {
-#pragma omp parallel for private(btm, lft, top, rit, bl, tr)
-            for (j = 0; j < numOfPartition; ++j)
-            {
-                btm = double(j) / numOfPartition;
-                lft = double(i) / numOfPartition;
-                top = double(j + 1) / numOfPartition;
-                rit = double(i + 1) / numOfPartition;
-                bl = Torus<double, 2>(array<double, 2>{lft, btm}, true);
-                tr = Torus<double, 2>(array<double, 2>{rit, top}, true);
-
-                calcedPDF[i][j] += GT2D.frequencyOfOrbit(bl, tr, orbit) * numOfPartition * numOfPartition;
-                // std::cout << calcedPDF[i][j] << std::endl;
-            }
+            calcedPDF[i][j] = result.density(array<size_t, 2>{i, j});
         }
     }
 
-    calcedPDF /= numOfExperiments;
-
-    // plot
-
-    adapt::CanvasCM canvas(filename + ".png");
+    adapt::CanvasCM canvas(name + ".png");
     std::pair<double, double> xrange = {0, 1}, yrange = {0, 1};
 
     // canvas.SetPaletteDefined({{0, "yellow"}, {0.4, "red"}, {0.8, "black"}, {1.2, "blue"}, {1.6, "cyan"}});
@@ -111,4 +152,5 @@ int main(int argc, char *argv[])
     canvas.SetCBRange(0, 2);
     canvas.SetTitle("p = " + std::to_string(p) + " q = " + std::to_string(q) + " r = " + std::to_string(r) + " s = " + std::to_string(s));
     canvas.PlotColormap(calcedPDF, xrange, yrange, adapt::plot::notitle);
+#endif
 }
\ No newline at end of file
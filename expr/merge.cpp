@@ -0,0 +1,84 @@
+#include "../simulator/shard.hpp"
+#include <iostream>
+#include <string>
+#include <vector>
+
+using std::string;
+using std::vector;
+
+template <size_t n>
+void mergeDensities(const string &output, const vector<string> &inputs)
+{
+    vector<GaussSim::DensityResult<n>> results;
+
+    for (const string &input : inputs)
+    {
+        results.push_back(GaussSim::DensityResult<n>::load(input));
+    }
+    GaussSim::DensityResult<n> merged = GaussSim::mergeDensities(std::move(results));
+    merged.save(output);
+
+    std::cout << merged.getParameters() << " seed=" << merged.getSeed() << ": experiments [" << merged.getFirst() << ", " << merged.getLast() << "), "
+              << merged.getNumOfExperiments() << " of " << merged.getTotalOfExperiments() << ", " << merged.getHistogram().getNumOfSamples() << " samples"
+              << (merged.complete() ? "" : " (incomplete)") << std::endl;
+}
+
+void mergeFrequencies(const string &output, const vector<string> &inputs)
+{
+    vector<GaussSim::FrequencyPartial> partials;
+
+    for (const string &input : inputs)
+    {
+        partials.push_back(GaussSim::FrequencyPartial::load(input));
+    }
+    GaussSim::FrequencyPartial merged = GaussSim::mergeFrequencies(std::move(partials));
+    merged.save(output);
+
+    std::cout << merged.parameters << ": experiments " << merged.first << " - " << merged.first + merged.frequencies.size() - 1
+              << " of " << merged.numOfExperiments << ", mean frequency " << merged.mean() << (merged.complete() ? "" : " (incomplete)") << std::endl;
+}
+
+// ./merge output input [input ...]
+// the reduce step of sharded runs: merges the density results (.gsd) or the frequency partials of the shards into output,
+// which is again a density result / frequency partial (so merged files can be merged further)
+// the shards only communicate through these files, so they can be run by any batch system, e.g.
+//   for i in 0 1 2 3; do ./xp_simulate p=1 shard=$i/4 & done; wait; ./merge P=1.gsd P=1.000000.seed-0.shard-*.gsd
+// the results must be of the same run (the same parameters and seed) and cover consecutive experiments without overlaps
+int main(int argc, char *argv[])
+{
+    if (argc < 3)
+    {
+        std::cerr << "usage: " << argv[0] << " output input [input ...]" << std::endl;
+        return 1;
+    }
+
+    const string output = argv[1];
+    const vector<string> inputs(argv + 2, argv + argc);
+
+    try
+    {
+        switch (GaussSim::densityResultDimension(inputs[0]))
+        {
+        case 0:
+            mergeFrequencies(output, inputs);
+            break;
+        case 1:
+            mergeDensities<1>(output, inputs);
+            break;
+        case 2:
+            mergeDensities<2>(output, inputs);
+            break;
+        case 3:
+            mergeDensities<3>(output, inputs);
+            break;
+        default:
+            std::cerr << inputs[0] << ": density results of dimension > 3 are not supported" << std::endl;
+            return 1;
+        }
+    }
+    catch (const std::exception &e)
+    {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+}
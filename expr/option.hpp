@@ -14,6 +14,18 @@ struct Options
     int iterationRate = 1000;
     int numOfExperiments = 100;
     bool filtered = false;
+    double sigma = 0; // the width (in bins) of the gaussian smoothing, 0: not smoothed
+    string checkpoint = ""; // the checkpoint file to resume from and save to, "": no checkpoint
+
+    // parameter sweeps
+    int M = 0;                        // the index of the grid
+    int grid = 10;                    // the number of divisions of each parameter
+    string output = "sweep_results";  // the directory to which the results are written
+    int numOfThreads = 0;             // 0: all cores
+    unsigned long long seed = 0;
+
+    // sharded runs
+    string shard = "0/1"; // index/count: run the index-th of count parts of the experiments
 };
 
 enum OptionType
@@ -24,6 +36,14 @@ enum OptionType
     OT_ITR,
     OT_NOEXP,
     OT_FILT,
+    OT_SIGMA,
+    OT_CKPT,
+    OT_M,
+    OT_GRID,
+    OT_OUT,
+    OT_THREADS,
+    OT_SEED,
+    OT_SHARD,
 
     OT_INVALID = -1,
 };
@@ -67,6 +87,22 @@ OptionType getOptionType(string typestr)
         return OT_NOEXP;
     else if (typestr == "filt" || typestr == "FILTER")
         return OT_FILT;
+    else if (typestr == "sigma" || typestr == "SIGMA")
+        return OT_SIGMA;
+    else if (typestr == "ckpt" || typestr == "CKPT")
+        return OT_CKPT;
+    else if (typestr == "m" || typestr == "M")
+        return OT_M;
+    else if (typestr == "grid" || typestr == "GRID")
+        return OT_GRID;
+    else if (typestr == "out" || typestr == "OUT")
+        return OT_OUT;
+    else if (typestr == "threads" || typestr == "THREADS")
+        return OT_THREADS;
+    else if (typestr == "seed" || typestr == "SEED")
+        return OT_SEED;
+    else if (typestr == "shard" || typestr == "SHARD")
+        return OT_SHARD;
     else
         return OT_INVALID;
 }
@@ -98,6 +134,30 @@ bool parseOption(Options *opt, OptionType type, string data)
         else
             return false;
         break;
+    case OT_SIGMA:
+        opt->sigma = std::stod(data);
+        break;
+    case OT_CKPT:
+        opt->checkpoint = data;
+        break;
+    case OT_M:
+        opt->M = std::stoi(data);
+        break;
+    case OT_GRID:
+        opt->grid = std::stoi(data);
+        break;
+    case OT_OUT:
+        opt->output = data;
+        break;
+    case OT_THREADS:
+        opt->numOfThreads = std::stoi(data);
+        break;
+    case OT_SEED:
+        opt->seed = std::stoull(data);
+        break;
+    case OT_SHARD:
+        opt->shard = data;
+        break;
     default:
         return false;
     }
@@ -0,0 +1,92 @@
+#include "../simulator/densityresult.hpp"
+#include <array>
+#include <vector>
+#include <iostream>
+#include <string>
+
+#include <OpenADAPT/Plot/Canvas.h>
+
+using std::array;
+using std::vector;
+
+template <size_t n>
+GaussSim::DensityResult<n> loadAll(int argc, char *argv[])
+{
+    vector<GaussSim::DensityResult<n>> results;
+    int k;
+
+    for (k = 2; k < argc; ++k)
+    {
+        results.push_back(GaussSim::DensityResult<n>::load(argv[k]));
+    }
+
+    return GaussSim::mergeDensities(std::move(results));
+}
+
+// ./plot filename result.gsd [result.gsd ...]
+// merges the density results (the shards of a run, see ./merge) and plots them into filename.png:
+// lines for 1-dimensional results (xp_simulate), a colormap for 2-dimensional results (md_gauss, sweep)
+int main(int argc, char *argv[])
+{
+    if (argc < 3)
+    {
+        std::cerr << "usage: " << argv[0] << " filename result.gsd [result.gsd ...]" << std::endl;
+        return 1;
+    }
+
+    const std::string filename = argv[1];
+    const size_t dimension = GaussSim::densityResultDimension(argv[2]);
+    size_t i, j;
+
+    if (dimension == 1)
+    {
+        auto result = loadAll<1>(argc, argv);
+        const size_t N = result.getHistogram().getShape()[0];
+        vector<double> times(N, 0), density = result.density();
+
+        for (i = 0; i < N; ++i)
+        {
+            times[i] = (i + 0.5) / N;
+        }
+
+        adapt::Canvas2D canvas(filename + ".png");
+
+        canvas.SetTitle(result.getParameters() + " (" + std::to_string(result.getNumOfExperiments()) + " experiments)");
+        canvas.SetYRangeMin(0);
+        canvas.SetXLabel("[0, 1]");
+        canvas.SetYLabel("density");
+
+        canvas.PlotPoints(times, density, adapt::plot::s_lines, adapt::plot::notitle);
+    }
+    else if (dimension == 2)
+    {
+        auto result = loadAll<2>(argc, argv);
+        const array<size_t, 2> shape = result.getHistogram().getShape();
+        adapt::Matrix<double> density(shape[0], shape[1]);
+        std::pair<double, double> xrange = {0, 1}, yrange = {0, 1};
+
+        for (i = 0; i < shape[0]; ++i)
+        {
+            for (j = 0; j < shape[1]; ++j)
+            {
+                density[i][j] = result.density(array<size_t, 2>{i, j});
+            }
+        }
+
+        adapt::CanvasCM canvas(filename + ".png");
+
+        canvas.SetSizeRatio(-1);
+        canvas.SetXLabel("x");
+        canvas.SetYLabel("y");
+        canvas.SetXRange(0, 1);
+        canvas.SetYRange(0, 1);
+        canvas.SetCBRange(0, 2);
+        canvas.SetTitle(result.getParameters() + " (" + std::to_string(result.getNumOfExperiments()) + " experiments)");
+        canvas.PlotColormap(density, xrange, yrange, adapt::plot::notitle);
+    }
+    else
+    {
+        std::cerr << argv[2] << ": not a 1- or 2-dimensional density result" << std::endl;
+        return 1;
+    }
+}
@@ -0,0 +1,156 @@
+#include "../simulator/gauss.hpp"
+#include "../simulator/density.hpp"
+#include "../simulator/helper/workstealing.hpp"
+#include "../simulator/densityresult.hpp"
+#include <array>
+#include <vector>
+#include <cmath>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <mutex>
+
+#include "option.hpp"
+
+using std::array;
+using std::vector;
+
+Options options;
+
+// the parameters of md_gauss: phi(x) = x_0^{-p} x_1^{-q}, psi(x) = x_0^{-r} x_1^{-s}
+struct Parameters
+{
+    double p, q, r, s;
+};
+
+// the (i, j)-th point of the M-th grid (as expr/sample_results/M=*/i-j):
+// p + q = r + s = S = 0.5 + 0.1 M, p = S (1 / 4 + i / (2 grid)), s = S (1 / 4 + j / (2 grid))
+Parameters gridPoint(int M, int i, int j)
+{
+    const double S = 0.5 + 0.1 * M;
+    Parameters par;
+
+    par.p = S * (0.25 + 0.5 * i / options.grid);
+    par.q = S - par.p;
+    par.s = S * (0.25 + 0.5 * j / options.grid);
+    par.r = S - par.s;
+
+    return par;
+}
+
+// one parameter point: the experiments run as separate tasks and their histograms are merged (exactly, as counts)
+struct SweepPoint
+{
+    int i, j;
+    Parameters par;
+    GaussSim::DensityResult<2> result;
+    std::mutex mutex;
+    int numOfRemaining;
+};
+
+void writeResult(const SweepPoint &point, const std::filesystem::path &directory)
+{
+    const string name = std::to_string(point.i) + "-" + std::to_string(point.j);
+    const Parameters &par = point.par;
+    // the eigenvalues of [[p, q], [r, s]] (by absolute value)
+    const double trace = par.p + par.s, det = par.p * par.s - par.q * par.r;
+    const double disc = std::sqrt(trace * trace - 4 * det);
+
+    std::ofstream info(directory / (name + ".txt"));
+    info << "p = " << par.p << ", q = " << par.q << ", r = " << par.r << ", s = " << par.s << std::endl;
+    info << "ps - qr = " << det << std::endl;
+    info << "λ_1 = " << std::abs((trace + disc) / 2) << std::endl;
+    info << "λ_2 = " << std::abs((trace - disc) / 2) << std::endl;
+
+    point.result.save((directory / (name + ".gsd")).string());
+}
+
+// ./sweep M=0 grid=10 N=100 itr=1000 noexp=10 out=sweep_results threads=0 seed=0
+// computes the density of md_gauss (N x N cells, N * itr iterations, noexp experiments) at all the points 0 <= j <= i <= grid
+// of the M-th grid in one process, and writes out/M=<M>/i-j.txt (parameters) and i-j.gsd (density result) as each point finishes
+// every experiment is a task of a work-stealing pool, and the k-th experiment of the l-th point draws from randomStream(seed, l * noexp + k),
+// so the results do not depend on the number of threads
+int main(int argc, char *argv[])
+{
+    options = GetOptions(argc, argv);
+
+    // (-DGAUSSSIM_INSTRUMENT: a summary of the run and of each experiment is printed to stderr)
+    GAUSSSIM_INSTRUMENT_RUN("sweep M=" + std::to_string(options.M));
+
+    const std::filesystem::path directory = std::filesystem::path(options.output) / ("M=" + std::to_string(options.M));
+    const size_t numOfIteration = (size_t)options.iterationRate * options.N;
+    const array<size_t, 2> shape = {(size_t)options.N, (size_t)options.N};
+
+    // the points 0 <= j <= i <= grid
+    const size_t numOfPoints = (size_t)(options.grid + 1) * (options.grid + 2) / 2;
+    vector<std::unique_ptr<SweepPoint>> points;
+    std::mutex outputMutex;
+    size_t numOfFinished = 0;
+    int i, j, k;
+    size_t l;
+
+    std::filesystem::create_directories(directory);
+
+    for (i = 0; i <= options.grid; ++i)
+    {
+        for (j = 0; j <= i; ++j)
+        {
+            auto point = std::make_unique<SweepPoint>();
+            point->i = i;
+            point->j = j;
+            point->par = gridPoint(options.M, i, j);
+            // the result records the experiments l * noexp, ..., (l + 1) * noexp - 1 of the run of numOfPoints * noexp experiments of the seed
+            // (l: the index of the point)
+            point->result = GaussSim::DensityResult<2>(shape, "md_gauss p=" + std::to_string(point->par.p) + " q=" + std::to_string(point->par.q) +
+                                                                      " r=" + std::to_string(point->par.r) + " s=" + std::to_string(point->par.s) +
+                                                                      " N=" + std::to_string(options.N) + " itr=" + std::to_string(options.iterationRate),
+                                                       options.seed, points.size() * options.numOfExperiments, numOfPoints * options.numOfExperiments);
+            point->numOfRemaining = options.numOfExperiments;
+            points.push_back(std::move(point));
+        }
+    }
+
+    GaussSim::helper::WorkStealingPool pool(options.numOfThreads);
+
+    for (l = 0; l < points.size(); ++l)
+    {
+        for (k = 0; k < options.numOfExperiments; ++k)
+        {
+            pool.submit([&, l, k]()
+                        {
+                SweepPoint &point = *points[l];
+                const Parameters par = point.par;
+                GAUSSSIM_INSTRUMENT_EXPERIMENT(std::to_string(point.i) + "-" + std::to_string(point.j) + " experiment " + std::to_string(k));
+                auto ggt = GaussSim::makeStaticGGT<double, 2>(
+                    [par](array<double, 2> x) -> array<double, 2>
+                    {
+                        if (x[0] * x[1] == 0)
+                            return array<double, 2>{0, 0};
+                        return array<double, 2>{1 / (std::pow(x[0], par.p) * std::pow(x[1], par.q)),
+                                                1 / (std::pow(x[0], par.r) * std::pow(x[1], par.s))};
+                    });
+
+                // degenerate orbits (falling into (0, 0) etc.) are restarted from fresh points
+                GaussSim::DensityEstimator estimator(ggt, shape, numOfIteration, options.seed);
+                auto hist = estimator.experiment(l * options.numOfExperiments + k);
+
+                bool last;
+                {
+                    std::lock_guard<std::mutex> lock(point.mutex);
+                    point.result.add(hist);
+                    last = (--point.numOfRemaining == 0);
+                }
+                if (!last)
+                    return;
+
+                // the last experiment of the point writes the result
+                writeResult(point, directory);
+                std::lock_guard<std::mutex> lock(outputMutex);
+                ++numOfFinished;
+                std::cout << "[" << numOfFinished << "/" << points.size() << "] M=" << options.M << " " << point.i << "-" << point.j << std::endl; });
+        }
+    }
+
+    pool.wait();
+}
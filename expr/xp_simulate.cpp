@@ -1,12 +1,19 @@
 #include "../simulator/gauss.hpp"
+#include "../simulator/density.hpp"
 #include "../simulator/helper/filter.hpp"
+#include "../simulator/helper/checkpoint.hpp"
+#include "../simulator/shard.hpp"
+#include <algorithm>
 #include <array>
 #include <vector>
-#include <random>
 #include <iomanip>
 #include <sstream>
 
+// plotting is optional: without OpenADAPT only the density result (P=<p>.gsd) is written
+#if __has_include(<OpenADAPT/Plot/Canvas.h>)
 #include <OpenADAPT/Plot/Canvas.h>
+#define GAUSSSIM_PLOT
+#endif
 
 #include "option.hpp"
 
@@ -35,53 +42,82 @@ int main(int argc, char *argv[])
 
     options = GetOptions(argc, argv);
 
+    // (-DGAUSSSIM_INSTRUMENT: a summary of the run and of each experiment is printed to stderr)
+    GAUSSSIM_INSTRUMENT_RUN("xp_simulate");
+
     // setting
 
-    GaussSim::GGT<double, 1> ggt(xp);
-    GaussSim::Torus<double, 1> tl(true), br(true);
+    auto ggt = GaussSim::makeStaticGGT<double, 1>([](array<double, 1> x)
+                                                  { return xp(x); });
 
     int i, j;
     const int numOfIteration = options.iterationRate * options.N;
 
-    double interval_width = (double)1 / options.N;
+    vector<double> times(options.N, 0), densityMean(options.N, 0);
 
-    vector<double> times(options.N, 0), densitySum(options.N, 0), densityMean(options.N, 0);
+    // the j-th experiment draws from randomStream(seed, j), so a run can be split into shards (shard=index/count)
+    // which run as separate processes, and the merged results of the shards (./merge) are the result of the whole run
 
-    std::random_device seed;
-    std::mt19937_64 mt(seed());
-    std::uniform_real_distribution<double> ud(0, 1);
+    const GaussSim::Shard shard = GaussSim::Shard::parse(options.shard);
+    const std::string parameters = "xp_simulate p=" + to_string_with_precision(options.p) + " N=" + std::to_string(options.N) + " itr=" + std::to_string(options.iterationRate);
+    const std::string name = "P=" + to_string_with_precision(options.p) + (shard.whole() ? "" : ".seed-" + std::to_string(options.seed) + ".shard-" + shard.name());
 
-    for (j = 0; j < options.numOfExperiments; ++j)
-    {
-    REDO:
-        auto orbit = ggt.orbit(array<double, 1>{ud(mt)}, numOfIteration);
+    // the counts of the cells and the number of experiments of the shard are kept in a checkpoint,
+    // so that an interrupted run is resumed (bit-exactly) by running it again with the same ckpt=
+
+    GaussSim::helper::checkpoint::ExperimentState state;
+    GaussSim::helper::checkpoint::Checkpointer checkpointer(options.checkpoint);
+
+    state.config = parameters + " noexp=" + std::to_string(options.numOfExperiments) + " seed=" + std::to_string(options.seed) + " shard=" + shard.name() + " counts";
+    state.accumulator.assign(options.N, 0);
+    if (checkpointer.resume(state))
+        std::cout << "resumed from " << options.checkpoint << " after " << state.numOfExperiments << " experiments" << std::endl;
+
+    vector<double> &countSum = state.accumulator; // integers, exact as doubles
+    const int first = shard.first(options.numOfExperiments), last = shard.last(options.numOfExperiments);
 
-        if (orbit[orbit.size() - 1][0] == 0)
-            goto REDO;
+    // calculate density
+    // the experiments run in parallel (threads=) in blocks of one experiment per thread, and the checkpoint is updated after every block
+    // degenerate orbits (falling into 0 etc.) are restarted from fresh points
 
-        // calculate density
+    GaussSim::DensityEstimator estimator(ggt, array<size_t, 1>{(size_t)options.N}, numOfIteration, options.seed, GaussSim::DP_RESTART, options.numOfThreads);
+    const int blockSize = estimator.concurrency();
 
-#pragma omp parallel for private(tl, br)
+    for (j = first + state.numOfExperiments; j < last; j += blockSize)
+    {
+        const int end = std::min(j + blockSize, last);
+        auto hist = estimator.estimate(j, end);
         for (i = 0; i < options.N; ++i)
         {
-            tl[0] = (double)i / options.N;
-            br[0] = (double)(i + 1) / options.N;
-            times[i] = (tl[0] + br[0]) / 2;
-            densitySum[i] += ggt.frequencyOfOrbit(tl, br, orbit) / interval_width;
+            countSum[i] += hist.getCounts()[i];
         }
+
+        state.numOfExperiments = end - first;
+        checkpointer.update(state);
     }
+    checkpointer.save(state);
+
+    // save the raw result (see expr/plot.cpp and expr/merge.cpp to plot or merge results)
+
+    GaussSim::DensityResult<1> result(GaussSim::Histogram<1>(array<size_t, 1>{(size_t)options.N}, vector<size_t>(countSum.begin(), countSum.end())),
+                                      state.numOfExperiments, parameters, options.seed, first, options.numOfExperiments);
+    result.save(name + ".gsd");
 
+    densityMean = result.density();
     for (i = 0; i < options.N; ++i)
     {
-        densityMean[i] = densitySum[i] / options.numOfExperiments;
+        times[i] = (i + 0.5) / options.N;
     }
 
     if (options.filtered)
         densityMean = GaussSim::helper::filter::collection::SmoothingFilter7.applyFilter(densityMean);
+    if (options.sigma > 0)
+        densityMean = GaussSim::helper::filter::collection::gaussianFilter(options.sigma).applyFilter(densityMean);
 
     // plot density
 
-    adapt::Canvas2D canvas("P=" + to_string_with_precision(options.p) + ".png");
+#ifdef GAUSSSIM_PLOT
+    adapt::Canvas2D canvas(name + ".png");
 
     canvas.SetTitle("p = " + to_string_with_precision(options.p));
     canvas.SetYRangeMin(0);
@@ -89,4 +125,5 @@ int main(int argc, char *argv[])
     canvas.SetYLabel("density");
 
     canvas.PlotPoints(times, densityMean, adapt::plot::s_lines, adapt::plot::notitle);
+#endif
 }
\ No newline at end of file
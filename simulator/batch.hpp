@@ -0,0 +1,217 @@
+#pragma once
+
+#include "torus.hpp"
+
+#include <algorithm>
+#include <vector>
+
+namespace GaussSim
+{
+    using std::vector;
+
+    // the default number of points advanced together
+    const size_t defaultBatchSize = 256;
+
+    // the number of points processed by a thread at once in the batch toral operations
+    // (small enough that the lanes of a chunk stay in the cache)
+    const size_t toralChunkSize = 4096;
+
+    // K points on the n-dimensional torus in structure-of-arrays layout
+    // lanes[i][k] = the i-th coordinate of the k-th point, so that each coordinate is contiguous over the points
+    template <Real R, size_t n>
+    struct TorusBatch
+    {
+    public:
+        array<vector<R>, n> lanes;
+
+    public:
+        TorusBatch() {}
+        TorusBatch(size_t size);
+        TorusBatch(const vector<Torus<R, n>> &points);
+
+        size_t size() const { return lanes[0].size(); }
+
+        // get / set the k-th point
+        Torus<R, n> get(size_t k) const;
+        void set(size_t k, const Torus<R, n> &point);
+
+        vector<Torus<R, n>> toVector() const;
+
+        // parallel shift of all the points (the same values as Torus::operator+= / -= point by point)
+        TorusBatch<R, n> &operator+=(const Torus<R, n> &);
+        TorusBatch<R, n> &operator-=(const Torus<R, n> &);
+    };
+
+    // toral homomorphism applied to all the points in one pass (the same values as operator*(mat, tor) point by point)
+    // the points are processed in chunks in parallel (with OpenMP), and each result is wrapped as soon as it is computed
+    template <Real R, size_t n, size_t m>
+    TorusBatch<R, m> operator*(const Matrix<int, m, n> &mat, const TorusBatch<R, n> &batch);
+
+    // the same for points in array-of-structures layout
+    template <Real R, size_t n, size_t m>
+    vector<Torus<R, m>> operator*(const Matrix<int, m, n> &mat, const vector<Torus<R, n>> &points);
+
+    template <Real R, size_t n>
+    TorusBatch<R, n>::TorusBatch(size_t size)
+    {
+        GAUSSSIM_COUNT(IC_ALLOCATION, 1);
+        GAUSSSIM_COUNT(IC_ALLOCATED_BYTES, size * n * sizeof(R));
+
+        size_t i;
+        for (i = 0; i < n; ++i)
+        {
+            lanes[i].assign(size, static_cast<R>(0));
+        }
+    }
+
+    template <Real R, size_t n>
+    TorusBatch<R, n>::TorusBatch(const vector<Torus<R, n>> &points)
+        : TorusBatch(points.size())
+    {
+        size_t k;
+        for (k = 0; k < points.size(); ++k)
+        {
+            set(k, points[k]);
+        }
+    }
+
+    template <Real R, size_t n>
+    Torus<R, n> TorusBatch<R, n>::get(size_t k) const
+    {
+        Torus<R, n> point;
+        size_t i;
+        for (i = 0; i < n; ++i)
+        {
+            point.coordinate[i] = lanes[i][k];
+        }
+
+        return point;
+    }
+
+    template <Real R, size_t n>
+    void TorusBatch<R, n>::set(size_t k, const Torus<R, n> &point)
+    {
+        size_t i;
+        for (i = 0; i < n; ++i)
+        {
+            lanes[i][k] = point.coordinate[i];
+        }
+    }
+
+    template <Real R, size_t n>
+    vector<Torus<R, n>> TorusBatch<R, n>::toVector() const
+    {
+        vector<Torus<R, n>> points;
+        size_t k;
+
+        points.reserve(size());
+        for (k = 0; k < size(); ++k)
+        {
+            points.push_back(get(k));
+        }
+
+        return points;
+    }
+
+    template <Real R, size_t n>
+    TorusBatch<R, n> &TorusBatch<R, n>::operator+=(const Torus<R, n> &shift)
+    {
+        const size_t K = size();
+        size_t i, k;
+
+        for (i = 0; i < n; ++i)
+        {
+            R *lane = lanes[i].data();
+            const R d = shift.coordinate[i];
+            for (k = 0; k < K; ++k)
+            {
+                lane[k] = MOD1<R>(lane[k] + d);
+            }
+        }
+
+        return *this;
+    }
+
+    template <Real R, size_t n>
+    TorusBatch<R, n> &TorusBatch<R, n>::operator-=(const Torus<R, n> &shift)
+    {
+        const size_t K = size();
+        size_t i, k;
+
+        for (i = 0; i < n; ++i)
+        {
+            R *lane = lanes[i].data();
+            const R d = shift.coordinate[i];
+            for (k = 0; k < K; ++k)
+            {
+                lane[k] = MOD1<R>(lane[k] - d);
+            }
+        }
+
+        return *this;
+    }
+
+    template <Real R, size_t n, size_t m>
+    TorusBatch<R, m> operator*(const Matrix<int, m, n> &mat, const TorusBatch<R, n> &batch)
+    {
+        const size_t K = batch.size();
+        const long long numOfChunks = (K + toralChunkSize - 1) / toralChunkSize;
+        TorusBatch<R, m> res(K);
+        long long c;
+
+#pragma omp parallel for schedule(static)
+        for (c = 0; c < numOfChunks; ++c)
+        {
+            const size_t first = c * toralChunkSize;
+            const size_t last = std::min(first + toralChunkSize, K);
+            size_t i, j, k;
+
+            for (i = 0; i < m; ++i)
+            {
+                R *dst = res.lanes[i].data();
+                for (j = 0; j < n; ++j)
+                {
+                    const R *src = batch.lanes[j].data();
+                    const int entry = mat.entries[i][j];
+                    for (k = first; k < last; ++k)
+                    {
+                        dst[k] += entry * src[k];
+                    }
+                }
+                for (k = first; k < last; ++k)
+                {
+                    dst[k] = MOD1<R>(dst[k]);
+                }
+            }
+        }
+
+        return res;
+    }
+
+    template <Real R, size_t n, size_t m>
+    vector<Torus<R, m>> operator*(const Matrix<int, m, n> &mat, const vector<Torus<R, n>> &points)
+    {
+        const long long K = points.size();
+        vector<Torus<R, m>> res(K);
+        long long k;
+
+#pragma omp parallel for schedule(static)
+        for (k = 0; k < K; ++k)
+        {
+            const array<R, n> &x = points[k].coordinate;
+            array<R, m> &y = res[k].coordinate;
+            size_t i, j;
+
+            for (i = 0; i < m; ++i)
+            {
+                for (j = 0; j < n; ++j)
+                {
+                    y[i] += mat.entries[i][j] * x[j];
+                }
+                y[i] = MOD1<R>(y[i]);
+            }
+        }
+
+        return res;
+    }
+}
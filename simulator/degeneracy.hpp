@@ -0,0 +1,119 @@
+#pragma once
+
+#include "torus.hpp"
+
+#include <cmath>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+
+namespace GaussSim
+{
+    // what to do when an orbit degenerates (falls into a fixed point such as 0 of INVERSE, or a short cycle)
+    enum DegeneracyPolicy
+    {
+        DP_IGNORE,   // keep iterating (no detection)
+        DP_ABORT,    // throw DegenerateOrbitError
+        DP_RESTART,  // discard the orbit and start again from a fresh random point
+        DP_TRUNCATE, // stop the orbit at the point where the degeneracy is detected
+    };
+
+    struct DegeneracyGuard
+    {
+        DegeneracyPolicy policy = DP_IGNORE;
+        // cycles whose period is at most maxPeriod are detected
+        size_t maxPeriod = 16;
+        // DP_RESTART gives up (throws DegenerateOrbitError) after this number of restarts
+        size_t maxRestarts = 1000;
+        // the i-th restart starts from a point drawn from randomStream(seed, i)
+        // (give different seeds to different experiments)
+        std::uint64_t seed = 0;
+
+        DegeneracyGuard() {}
+        DegeneracyGuard(DegeneracyPolicy policy, std::uint64_t seed = 0)
+            : policy(policy), seed(seed) {}
+    };
+
+    class DegenerateOrbitError : public std::runtime_error
+    {
+    public:
+        size_t step;   // the index of the orbit point where the degeneracy is detected
+        size_t period; // the period of the cycle (0 if the point is not finite)
+
+        DegenerateOrbitError(size_t step, size_t period)
+            : std::runtime_error("degenerate orbit: cycle of period " + std::to_string(period) + " detected at step " + std::to_string(step)),
+              step(step), period(period) {}
+    };
+
+    // brent's cycle detection restricted to short cycles
+    // the points of an orbit are fed one by one, and feed() returns true when
+    // the orbit turns out to be in a cycle of period <= maxPeriod or reaches a non-finite point
+    template <Real R, size_t n>
+    class CycleDetector
+    {
+    protected:
+        Torus<R, n> tortoise;
+        size_t power = 1;  // the length of the current search window (a power of 2, stops growing at maxPeriod)
+        size_t lambda = 0; // the distance between tortoise and the last point
+        size_t maxPeriod;
+        size_t detectedPeriod = 0;
+        bool started = false;
+
+    public:
+        CycleDetector(size_t maxPeriod) : maxPeriod(maxPeriod) {}
+
+        bool feed(const Torus<R, n> &point);
+        void reset();
+
+        // the period of the detected cycle (0 if a non-finite point is detected)
+        size_t period() const { return detectedPeriod; }
+    };
+
+    template <Real R, size_t n>
+    bool CycleDetector<R, n>::feed(const Torus<R, n> &point)
+    {
+        size_t i;
+        for (i = 0; i < n; ++i)
+        {
+            if (!std::isfinite(static_cast<double>(point.coordinate[i])))
+            {
+                detectedPeriod = 0;
+                return true;
+            }
+        }
+
+        if (!started)
+        {
+            tortoise = point;
+            started = true;
+            return false;
+        }
+
+        ++lambda;
+        if (point.coordinate == tortoise.coordinate)
+        {
+            detectedPeriod = lambda;
+            return true;
+        }
+
+        if (lambda == power)
+        {
+            // move the tortoise to the last point and widen the window
+            tortoise = point;
+            if (power < maxPeriod)
+                power *= 2;
+            lambda = 0;
+        }
+
+        return false;
+    }
+
+    template <Real R, size_t n>
+    void CycleDetector<R, n>::reset()
+    {
+        power = 1;
+        lambda = 0;
+        detectedPeriod = 0;
+        started = false;
+    }
+}
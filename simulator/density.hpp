@@ -0,0 +1,92 @@
+#pragma once
+
+#include "gauss.hpp"
+#include "histogram.hpp"
+#include "random.hpp"
+#include "degeneracy.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <string>
+#include <thread>
+
+namespace GaussSim
+{
+    using std::array;
+
+    // the density of a generalized gauss transformation estimated by independent experiments
+    // the k-th experiment draws the seed of its DegeneracyGuard and then its initial point from randomStream(seed, k),
+    // and gives the histogram of the orbit of depth points on the grid of gridShape
+    // estimate() runs the experiments in parallel (with OpenMP): every thread adds its experiments to its own histogram,
+    // and the histograms of the threads are added up at the end
+    // the counts are integers, so the result depends only on seed, not on the number of threads or the schedule
+    template <Real R, size_t n, Transformation<R, n> F>
+    class DensityEstimator
+    {
+    protected:
+        StaticGGT<R, n, F> ggt;
+        array<size_t, n> gridShape;
+        size_t depth;
+        std::uint64_t seed;
+        DegeneracyPolicy policy;
+        size_t numOfThreads;
+
+    public:
+        // numOfThreads = 0: all cores
+        DensityEstimator(const StaticGGT<R, n, F> &ggt, array<size_t, n> gridShape, size_t depth, std::uint64_t seed = 0,
+                         DegeneracyPolicy policy = DP_RESTART, size_t numOfThreads = 0)
+            : ggt(ggt), gridShape(gridShape), depth(depth), seed(seed), policy(policy), numOfThreads(numOfThreads) {}
+
+        array<size_t, n> getGridShape() const { return gridShape; }
+        // the number of threads estimate() runs on
+        size_t concurrency() const;
+
+        // the histogram of the k-th experiment alone (for callers with their own scheduling, e.g. a work-stealing pool)
+        Histogram<n> experiment(size_t k) const;
+        // the sum of the histograms of the experiments first, ..., last - 1
+        Histogram<n> estimate(size_t first, size_t last) const;
+        Histogram<n> estimate(size_t numOfExperiments) const { return estimate(0, numOfExperiments); }
+    };
+
+    template <Real R, size_t n, Transformation<R, n> F>
+    size_t DensityEstimator<R, n, F>::concurrency() const
+    {
+        return numOfThreads > 0 ? numOfThreads : std::max(1u, std::thread::hardware_concurrency());
+    }
+
+    template <Real R, size_t n, Transformation<R, n> F>
+    Histogram<n> DensityEstimator<R, n, F>::experiment(size_t k) const
+    {
+        std::mt19937_64 engine = randomStream(seed, k);
+        DegeneracyGuard guard(policy, engine());
+        Torus<R, n> initial = randomTorus<R, n>(engine);
+
+        return ggt.densityHistogram(initial, depth, gridShape, guard);
+    }
+
+    template <Real R, size_t n, Transformation<R, n> F>
+    Histogram<n> DensityEstimator<R, n, F>::estimate(size_t first, size_t last) const
+    {
+        Histogram<n> total(gridShape);
+        size_t k;
+
+        // no shared state is written inside the loop: the threads only add to their own histograms
+#pragma omp parallel num_threads(concurrency())
+        {
+            Histogram<n> local(gridShape);
+
+#pragma omp for schedule(dynamic) nowait
+            for (k = first; k < last; ++k)
+            {
+                GAUSSSIM_INSTRUMENT_EXPERIMENT("experiment " + std::to_string(k));
+                local += experiment(k);
+            }
+
+#pragma omp critical(GaussSimDensityEstimator)
+            total += local;
+        }
+
+        return total;
+    }
+}
@@ -0,0 +1,267 @@
+#pragma once
+
+#include "histogram.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <cstdint>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace GaussSim
+{
+    using std::string;
+    using std::vector;
+
+    // the result of density experiments: the merged histogram of the orbits of the experiments first, ..., first + numOfExperiments - 1
+    // of a run of totalOfExperiments experiments (the k-th experiment draws from randomStream(seed, k)), and the parameters
+    // results of the same run are merged by adding the counts, which is exact, so the merged results of the shards of a run
+    // are the result of the whole run (DensityResult() is the identity)
+    template <size_t n>
+    class DensityResult
+    {
+    protected:
+        Histogram<n> histogram;
+        size_t numOfExperiments = 0;
+        string parameters;
+        std::uint64_t seed = 0;
+        size_t first = 0;
+        size_t totalOfExperiments = 0;
+
+    public:
+        DensityResult() {}
+        // no experiments yet (add() the experiments first, first + 1, ...)
+        DensityResult(array<size_t, n> shape, string parameters, std::uint64_t seed, size_t first, size_t totalOfExperiments)
+            : histogram(shape), parameters(parameters), seed(seed), first(first), totalOfExperiments(totalOfExperiments) {}
+        DensityResult(Histogram<n> histogram, size_t numOfExperiments, string parameters, std::uint64_t seed, size_t first, size_t totalOfExperiments)
+            : histogram(histogram), numOfExperiments(numOfExperiments), parameters(parameters), seed(seed), first(first), totalOfExperiments(totalOfExperiments) {}
+
+        // add the histogram of one more experiment of the range (the experiments can be added in any order)
+        void add(const Histogram<n> &hist);
+
+        // merge the result of the adjacent experiments of the same run
+        // throws std::invalid_argument if the shapes, the parameters, the seeds or the runs differ, or the experiments overlap or leave a gap
+        DensityResult<n> &operator+=(const DensityResult<n> &result);
+
+        const Histogram<n> &getHistogram() const { return histogram; }
+        size_t getNumOfExperiments() const { return numOfExperiments; }
+        const string &getParameters() const { return parameters; }
+        std::uint64_t getSeed() const { return seed; }
+        size_t getFirst() const { return first; }
+        size_t getLast() const { return first + numOfExperiments; }
+        size_t getTotalOfExperiments() const { return totalOfExperiments; }
+        // all the experiments of the run are merged
+        bool complete() const { return numOfExperiments == totalOfExperiments; }
+
+        // the normalized density of the merged orbits (the mean of the densities of the experiments of the same length)
+        double density(array<size_t, n> cell) const { return histogram.density(cell); }
+        vector<double> density() const { return histogram.density(); }
+
+        // binary file (little endian):
+        //   magic "GSDENS02", n, shape[0], ..., shape[n-1], numOfSamples, numOfExperiments, seed, first, totalOfExperiments,
+        //   parameters (length + bytes), counts (in the order of Histogram::getCounts()) as LEB128 variable-length integers
+        // throws std::runtime_error if the file cannot be written / read, or is not a density result of dimension n
+        void save(const string &path) const;
+        static DensityResult<n> load(const string &path);
+    };
+
+    // merge results of the same run (given in any order) which together cover consecutive experiments into one result
+    // throws std::invalid_argument if the results are of different runs, overlap, or leave a gap
+    template <size_t n>
+    DensityResult<n> mergeDensities(vector<DensityResult<n>> results);
+
+    const char densityResultMagic[8] = {'G', 'S', 'D', 'E', 'N', 'S', '0', '2'};
+
+    namespace detail
+    {
+        inline void writeFixed(std::ostream &out, std::uint64_t value)
+        {
+            out.write(reinterpret_cast<const char *>(&value), sizeof(value));
+        }
+
+        inline std::uint64_t readFixed(std::istream &in)
+        {
+            std::uint64_t value = 0;
+            in.read(reinterpret_cast<char *>(&value), sizeof(value));
+            return value;
+        }
+
+        // 7 bits per byte, the highest bit marks that more bytes follow (counts of sparse grids take 1-3 bytes)
+        inline void writeVarint(std::ostream &out, std::uint64_t value)
+        {
+            char byte;
+            do
+            {
+                byte = static_cast<char>(value & 0x7f);
+                value >>= 7;
+                if (value != 0)
+                    byte |= static_cast<char>(0x80);
+                out.put(byte);
+            } while (value != 0);
+        }
+
+        inline std::uint64_t readVarint(std::istream &in)
+        {
+            std::uint64_t value = 0;
+            int shift = 0;
+            int byte;
+            do
+            {
+                byte = in.get();
+                if (byte == EOF || shift > 63)
+                    throw std::runtime_error("density result: broken count");
+                value |= static_cast<std::uint64_t>(byte & 0x7f) << shift;
+                shift += 7;
+            } while (byte & 0x80);
+
+            return value;
+        }
+    }
+
+    template <size_t n>
+    void DensityResult<n>::add(const Histogram<n> &hist)
+    {
+        histogram += hist;
+        ++numOfExperiments;
+    }
+
+    template <size_t n>
+    DensityResult<n> &DensityResult<n>::operator+=(const DensityResult<n> &result)
+    {
+        if (result.histogram.numOfCells() == 0 && result.numOfExperiments == 0)
+            return *this;
+        if (histogram.numOfCells() == 0 && numOfExperiments == 0)
+            return *this = result;
+
+        if (histogram.getShape() != result.histogram.getShape())
+            throw std::invalid_argument("DensityResult: the shapes differ");
+        if (parameters != result.parameters)
+            throw std::invalid_argument("DensityResult: the parameters differ (" + parameters + " / " + result.parameters + ")");
+        if (seed != result.seed)
+            throw std::invalid_argument("DensityResult: the seeds differ (" + std::to_string(seed) + " / " + std::to_string(result.seed) + ")");
+        if (totalOfExperiments != result.totalOfExperiments)
+            throw std::invalid_argument("DensityResult: the results are of different runs (" + std::to_string(totalOfExperiments) + " / " +
+                                        std::to_string(result.totalOfExperiments) + " experiments)");
+        if (first < result.getLast() && result.first < getLast())
+            throw std::invalid_argument("DensityResult: the experiments overlap at the experiment " + std::to_string(std::max(first, result.first)));
+        if (getLast() != result.first && result.getLast() != first)
+            throw std::invalid_argument("DensityResult: the experiments from " + std::to_string(std::min(getLast(), result.getLast())) + " to " +
+                                        std::to_string(std::max(first, result.first) - 1) + " are missing");
+
+        histogram += result.histogram;
+        numOfExperiments += result.numOfExperiments;
+        first = std::min(first, result.first);
+
+        return *this;
+    }
+
+    template <size_t n>
+    void DensityResult<n>::save(const string &path) const
+    {
+        static_assert(std::endian::native == std::endian::little, "the density result format is little endian");
+
+        std::ofstream out(path, std::ios::binary | std::ios::trunc);
+        const array<size_t, n> shape = histogram.getShape();
+        size_t i;
+
+        out.write(densityResultMagic, sizeof(densityResultMagic));
+        detail::writeFixed(out, n);
+        for (i = 0; i < n; ++i)
+        {
+            detail::writeFixed(out, shape[i]);
+        }
+        detail::writeFixed(out, histogram.getNumOfSamples());
+        detail::writeFixed(out, numOfExperiments);
+        detail::writeFixed(out, seed);
+        detail::writeFixed(out, first);
+        detail::writeFixed(out, totalOfExperiments);
+        detail::writeFixed(out, parameters.size());
+        out.write(parameters.data(), parameters.size());
+        for (size_t count : histogram.getCounts())
+        {
+            detail::writeVarint(out, count);
+        }
+
+        if (!out)
+            throw std::runtime_error("density result: cannot write " + path);
+    }
+
+    template <size_t n>
+    DensityResult<n> DensityResult<n>::load(const string &path)
+    {
+        std::ifstream in(path, std::ios::binary);
+        char magic[sizeof(densityResultMagic)];
+        array<size_t, n> shape;
+        size_t cells = 1, numOfSamples, experiments, firstExperiment, total, i;
+        std::uint64_t seedOfRun;
+        string params;
+
+        if (!in)
+            throw std::runtime_error("density result: cannot open " + path);
+
+        in.read(magic, sizeof(magic));
+        if (!in || !std::equal(magic, magic + sizeof(magic), densityResultMagic))
+            throw std::runtime_error("density result: " + path + " is not a density result");
+        if (detail::readFixed(in) != n)
+            throw std::runtime_error("density result: " + path + " is not of dimension " + std::to_string(n));
+
+        for (i = 0; i < n; ++i)
+        {
+            shape[i] = detail::readFixed(in);
+            cells *= shape[i];
+        }
+        numOfSamples = detail::readFixed(in);
+        experiments = detail::readFixed(in);
+        seedOfRun = detail::readFixed(in);
+        firstExperiment = detail::readFixed(in);
+        total = detail::readFixed(in);
+        params.resize(detail::readFixed(in));
+        in.read(params.data(), params.size());
+        // the experiments [first, first + experiments) must lie in the run
+        if (!in || experiments > total || firstExperiment > total - experiments)
+            throw std::runtime_error("density result: " + path + " is broken");
+
+        vector<size_t> counts(cells);
+        for (i = 0; i < cells; ++i)
+        {
+            counts[i] = detail::readVarint(in);
+        }
+
+        Histogram<n> hist(shape, std::move(counts));
+        if (hist.getNumOfSamples() != numOfSamples)
+            throw std::runtime_error("density result: " + path + " is broken (the counts do not sum up to the number of samples)");
+
+        return DensityResult<n>(std::move(hist), experiments, params, seedOfRun, firstExperiment, total);
+    }
+
+    template <size_t n>
+    DensityResult<n> mergeDensities(vector<DensityResult<n>> results)
+    {
+        DensityResult<n> merged;
+
+        std::sort(results.begin(), results.end(), [](const DensityResult<n> &a, const DensityResult<n> &b)
+                  { return a.getFirst() < b.getFirst() || (a.getFirst() == b.getFirst() && a.getLast() < b.getLast()); });
+
+        for (const DensityResult<n> &result : results)
+        {
+            merged += result;
+        }
+
+        return merged;
+    }
+
+    // the dimension of the density result in the file (0 if it is not a density result)
+    inline size_t densityResultDimension(const string &path)
+    {
+        std::ifstream in(path, std::ios::binary);
+        char magic[sizeof(densityResultMagic)];
+
+        in.read(magic, sizeof(magic));
+        if (!in || !std::equal(magic, magic + sizeof(magic), densityResultMagic))
+            return 0;
+
+        return detail::readFixed(in);
+    }
+}
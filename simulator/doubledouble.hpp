@@ -0,0 +1,263 @@
+#pragma once
+
+#include "real.hpp"
+#include "torus.hpp"
+
+#include <cmath>
+
+namespace GaussSim
+{
+    // double-double number: the unevaluated sum hi + lo with |lo| <= ulp(hi) / 2 (about 106 bits of precision)
+    // the arithmetic is built on the error-free transformations TwoSum and TwoProd (std::fma), without branches
+    struct DoubleDouble
+    {
+    public:
+        double hi = 0;
+        double lo = 0;
+
+    public:
+        DoubleDouble() {}
+        DoubleDouble(double d) : hi(d), lo(0) {}
+        DoubleDouble(int i) : hi(i), lo(0) {}
+        DoubleDouble(long long i);
+        DoubleDouble(double hi, double lo) : hi(hi), lo(lo) {}
+
+        operator double() const { return hi + lo; }
+
+        DoubleDouble operator-() const { return DoubleDouble(-hi, -lo); }
+
+        DoubleDouble &operator+=(const DoubleDouble &);
+        DoubleDouble &operator-=(const DoubleDouble &);
+        DoubleDouble &operator*=(const DoubleDouble &);
+        DoubleDouble &operator/=(const DoubleDouble &);
+
+    public:
+        // error-free transformations
+        // a + b = s + e exactly
+        static DoubleDouble twoSum(double a, double b);
+        // a + b = s + e exactly, provided |a| >= |b|
+        static DoubleDouble quickTwoSum(double a, double b);
+        // a * b = p + e exactly
+        static DoubleDouble twoProd(double a, double b);
+    };
+
+    inline DoubleDouble DoubleDouble::twoSum(double a, double b)
+    {
+        double s = a + b;
+        double bb = s - a;
+        double e = (a - (s - bb)) + (b - bb);
+        return DoubleDouble(s, e);
+    }
+
+    inline DoubleDouble DoubleDouble::quickTwoSum(double a, double b)
+    {
+        double s = a + b;
+        double e = b - (s - a);
+        return DoubleDouble(s, e);
+    }
+
+    inline DoubleDouble DoubleDouble::twoProd(double a, double b)
+    {
+        double p = a * b;
+        double e = std::fma(a, b, -p);
+        return DoubleDouble(p, e);
+    }
+
+    inline DoubleDouble::DoubleDouble(long long i)
+    {
+        // long long may not fit in a double
+        double h = static_cast<double>(i);
+        double l = static_cast<double>(i - static_cast<long long>(h));
+        *this = quickTwoSum(h, l);
+    }
+
+    // arithmetic
+
+    inline DoubleDouble operator+(const DoubleDouble &a, const DoubleDouble &b)
+    {
+        DoubleDouble s = DoubleDouble::twoSum(a.hi, b.hi);
+        DoubleDouble t = DoubleDouble::twoSum(a.lo, b.lo);
+        s.lo += t.hi;
+        s = DoubleDouble::quickTwoSum(s.hi, s.lo);
+        s.lo += t.lo;
+        return DoubleDouble::quickTwoSum(s.hi, s.lo);
+    }
+
+    inline DoubleDouble operator-(const DoubleDouble &a, const DoubleDouble &b)
+    {
+        return a + (-b);
+    }
+
+    inline DoubleDouble operator*(const DoubleDouble &a, const DoubleDouble &b)
+    {
+        DoubleDouble p = DoubleDouble::twoProd(a.hi, b.hi);
+        p.lo += a.hi * b.lo + a.lo * b.hi;
+        return DoubleDouble::quickTwoSum(p.hi, p.lo);
+    }
+
+    inline DoubleDouble operator/(const DoubleDouble &a, const DoubleDouble &b)
+    {
+        // long division: q1 + q2 + q3
+        double q1 = a.hi / b.hi;
+        DoubleDouble r = a - b * DoubleDouble(q1);
+        double q2 = r.hi / b.hi;
+        r = r - b * DoubleDouble(q2);
+        double q3 = r.hi / b.hi;
+        DoubleDouble q = DoubleDouble::quickTwoSum(q1, q2);
+        return q + DoubleDouble(q3);
+    }
+
+    inline DoubleDouble &DoubleDouble::operator+=(const DoubleDouble &a) { return *this = *this + a; }
+    inline DoubleDouble &DoubleDouble::operator-=(const DoubleDouble &a) { return *this = *this - a; }
+    inline DoubleDouble &DoubleDouble::operator*=(const DoubleDouble &a) { return *this = *this * a; }
+    inline DoubleDouble &DoubleDouble::operator/=(const DoubleDouble &a) { return *this = *this / a; }
+
+    // comparison
+
+    inline bool operator==(const DoubleDouble &a, const DoubleDouble &b) { return a.hi == b.hi && a.lo == b.lo; }
+    inline bool operator<(const DoubleDouble &a, const DoubleDouble &b) { return a.hi < b.hi || (a.hi == b.hi && a.lo < b.lo); }
+    inline bool operator>(const DoubleDouble &a, const DoubleDouble &b) { return b < a; }
+    inline bool operator<=(const DoubleDouble &a, const DoubleDouble &b) { return !(b < a); }
+    inline bool operator>=(const DoubleDouble &a, const DoubleDouble &b) { return !(a < b); }
+
+    // mixed operations with built-in arithmetic types
+    // (exact matches, so that they are preferred to the built-in operators through operator double())
+
+    template <BuiltinArithmetic T>
+    DoubleDouble operator+(const DoubleDouble &a, T b) { return a + DoubleDouble(static_cast<double>(b)); }
+    template <BuiltinArithmetic T>
+    DoubleDouble operator+(T a, const DoubleDouble &b) { return DoubleDouble(static_cast<double>(a)) + b; }
+    template <BuiltinArithmetic T>
+    DoubleDouble operator-(const DoubleDouble &a, T b) { return a - DoubleDouble(static_cast<double>(b)); }
+    template <BuiltinArithmetic T>
+    DoubleDouble operator-(T a, const DoubleDouble &b) { return DoubleDouble(static_cast<double>(a)) - b; }
+    template <BuiltinArithmetic T>
+    DoubleDouble operator*(const DoubleDouble &a, T b) { return a * DoubleDouble(static_cast<double>(b)); }
+    template <BuiltinArithmetic T>
+    DoubleDouble operator*(T a, const DoubleDouble &b) { return DoubleDouble(static_cast<double>(a)) * b; }
+    template <BuiltinArithmetic T>
+    DoubleDouble operator/(const DoubleDouble &a, T b) { return a / DoubleDouble(static_cast<double>(b)); }
+    template <BuiltinArithmetic T>
+    DoubleDouble operator/(T a, const DoubleDouble &b) { return DoubleDouble(static_cast<double>(a)) / b; }
+
+    template <BuiltinArithmetic T>
+    bool operator==(const DoubleDouble &a, T b) { return a == DoubleDouble(static_cast<double>(b)); }
+    template <BuiltinArithmetic T>
+    bool operator<(const DoubleDouble &a, T b) { return a < DoubleDouble(static_cast<double>(b)); }
+    template <BuiltinArithmetic T>
+    bool operator<(T a, const DoubleDouble &b) { return DoubleDouble(static_cast<double>(a)) < b; }
+    template <BuiltinArithmetic T>
+    bool operator>(const DoubleDouble &a, T b) { return DoubleDouble(static_cast<double>(b)) < a; }
+    template <BuiltinArithmetic T>
+    bool operator>(T a, const DoubleDouble &b) { return b < DoubleDouble(static_cast<double>(a)); }
+    template <BuiltinArithmetic T>
+    bool operator<=(const DoubleDouble &a, T b) { return !(a > b); }
+    template <BuiltinArithmetic T>
+    bool operator<=(T a, const DoubleDouble &b) { return !(a > b); }
+    template <BuiltinArithmetic T>
+    bool operator>=(const DoubleDouble &a, T b) { return !(a < b); }
+    template <BuiltinArithmetic T>
+    bool operator>=(T a, const DoubleDouble &b) { return !(a < b); }
+
+    // rounding
+
+    inline DoubleDouble floorDD(const DoubleDouble &a)
+    {
+        double h = std::floor(a.hi);
+        // if hi is not an integer, |lo| <= ulp(hi) / 2 cannot move hi + lo across an integer
+        double l = (h == a.hi) ? std::floor(a.lo) : 0;
+        return DoubleDouble::quickTwoSum(h, l);
+    }
+
+    inline DoubleDouble truncDD(const DoubleDouble &a)
+    {
+        return (a.hi < 0) ? -floorDD(-a) : floorDD(a);
+    }
+
+    // the functions required by Real
+
+    inline DoubleDouble mod1(DoubleDouble a)
+    {
+        // the same convention as mod1(double): the result has the sign of a
+        return a - truncDD(a);
+    }
+
+    inline NaturalNumber floor(DoubleDouble a)
+    {
+        DoubleDouble f = floorDD(a);
+        return static_cast<NaturalNumber>(f.hi) + static_cast<NaturalNumber>(f.lo);
+    }
+
+    // elementary functions for writing transformations (found by ADL, like std::abs, std::sqrt, ...)
+
+    inline DoubleDouble abs(const DoubleDouble &a)
+    {
+        return (a.hi < 0) ? -a : a;
+    }
+
+    inline DoubleDouble sqrt(const DoubleDouble &a)
+    {
+        double x = std::sqrt(a.hi);
+        if (!(a.hi > 0) || !std::isfinite(x))
+            return DoubleDouble(x);
+        // one newton step from the double approximation
+        return DoubleDouble::quickTwoSum(x, (a - DoubleDouble::twoProd(x, x)).hi / (2 * x));
+    }
+
+    inline DoubleDouble exp(const DoubleDouble &a)
+    {
+        const DoubleDouble ln2(6.931471805599452862e-01, 2.319046813846299558e-17);
+        const double scale = 1024; // exp(r) = exp(r / scale)^scale
+        const int numOfTerms = 12;
+        double k;
+        DoubleDouble r, term, sum;
+        int i;
+
+        if (a.hi > 709.8)
+            return DoubleDouble(HUGE_VAL);
+        if (a.hi < -745.2)
+            return DoubleDouble(0);
+
+        // a = k log 2 + r, |r| <= log(2) / 2
+        k = std::nearbyint(a.hi / ln2.hi);
+        r = (a - ln2 * k) / scale;
+
+        // taylor series of exp(r) - 1
+        term = r;
+        sum = r;
+        for (i = 2; i <= numOfTerms; ++i)
+        {
+            term = term * r / i;
+            sum += term;
+        }
+
+        // (1 + s)^2 - 1 = s (s + 2), repeated log2(scale) times
+        for (i = 0; i < 10; ++i)
+        {
+            sum = sum * (sum + 2);
+        }
+        sum += 1;
+
+        return DoubleDouble(std::ldexp(sum.hi, static_cast<int>(k)), std::ldexp(sum.lo, static_cast<int>(k)));
+    }
+
+    inline DoubleDouble log(const DoubleDouble &a)
+    {
+        double y = std::log(a.hi);
+        if (!(a.hi > 0) || !std::isfinite(y))
+            return DoubleDouble(y);
+        // one newton step on exp(y) = a
+        DoubleDouble yy(y);
+        return yy + a * exp(-yy) - 1;
+    }
+
+    inline DoubleDouble pow(const DoubleDouble &a, double p)
+    {
+        if (!(a.hi > 0))
+            return DoubleDouble(std::pow(a.hi, p));
+        return exp(log(a) * p);
+    }
+
+    template <size_t n>
+    using DDTorus = Torus<DoubleDouble, n>;
+}
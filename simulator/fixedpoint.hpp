@@ -0,0 +1,212 @@
+#pragma once
+
+#include "real.hpp"
+#include "torus.hpp"
+
+#include <cmath>
+#include <compare>
+#include <concepts>
+#include <cstdint>
+
+namespace GaussSim
+{
+    // a point of R/Z in 64-bit fixed point: bits represents bits / 2^64 in [0, 1)
+    // mod 1 is the overflow of the unsigned integer, so the addition, the subtraction and the multiplication by integers
+    // (i.e. the group operations and the toral homomorphisms) are exact and need no adjustment
+    // the product and the quotient of two points are rounded down
+    // (uses unsigned __int128, which gcc and clang provide on 64-bit targets)
+    struct FixedPoint64
+    {
+    public:
+        std::uint64_t bits = 0;
+
+    public:
+        FixedPoint64() {}
+        // d mod 1 (rounded down to a multiple of 2^-64)
+        FixedPoint64(double d);
+        // every integer is 0 in R/Z (in particular static_cast<FixedPoint64>(1) is 0, see isReducedMod1)
+        // explicit, so that an integer operand is never silently converted to 0 (a * m is the exact multiple)
+        explicit FixedPoint64(int) {}
+
+        static FixedPoint64 fromBits(std::uint64_t bits);
+
+        // the multiple of 2^-53 nearest below, so that the result is always in [0, 1)
+        operator double() const { return static_cast<double>(bits >> 11) * 0x1p-53; }
+
+        FixedPoint64 operator-() const { return fromBits(-bits); }
+
+        FixedPoint64 &operator+=(const FixedPoint64 &a);
+        FixedPoint64 &operator-=(const FixedPoint64 &a);
+        FixedPoint64 &operator*=(const FixedPoint64 &a);
+        FixedPoint64 &operator/=(const FixedPoint64 &a);
+        // a *= m would convert m to 0 through FixedPoint64(double): write a = a * m
+        template <std::integral T>
+        FixedPoint64 &operator*=(T) = delete;
+
+        // the index of the cell containing this point when [0, 1) is divided into N cells
+        // (a shift if N is a power of 2, and never rounded up to N)
+        std::uint64_t cell(std::uint64_t N) const { return static_cast<std::uint64_t>((static_cast<unsigned __int128>(bits) * N) >> 64); }
+    };
+
+    inline FixedPoint64::FixedPoint64(double d)
+    {
+        double f = d - std::floor(d);
+        if (!(f >= 0 && f < 1))
+        {
+            // nan or inf
+            bits = 0;
+            return;
+        }
+        f = std::ldexp(f, 64);
+        // f can be rounded up to 2^64 when d is just below an integer
+        bits = (f >= 0x1p64) ? 0 : static_cast<std::uint64_t>(f);
+    }
+
+    inline FixedPoint64 FixedPoint64::fromBits(std::uint64_t bits)
+    {
+        FixedPoint64 res;
+        res.bits = bits;
+        return res;
+    }
+
+    // arithmetic
+
+    inline FixedPoint64 operator+(const FixedPoint64 &a, const FixedPoint64 &b) { return FixedPoint64::fromBits(a.bits + b.bits); }
+    inline FixedPoint64 operator-(const FixedPoint64 &a, const FixedPoint64 &b) { return FixedPoint64::fromBits(a.bits - b.bits); }
+
+    inline FixedPoint64 operator*(const FixedPoint64 &a, const FixedPoint64 &b)
+    {
+        return FixedPoint64::fromBits(static_cast<std::uint64_t>((static_cast<unsigned __int128>(a.bits) * b.bits) >> 64));
+    }
+
+    inline FixedPoint64 operator/(const FixedPoint64 &a, const FixedPoint64 &b)
+    {
+        // the fractional part of the quotient (0 if b = 0, like INVERSE)
+        if (b.bits == 0)
+            return FixedPoint64();
+        return FixedPoint64::fromBits(static_cast<std::uint64_t>((static_cast<unsigned __int128>(a.bits) << 64) / b.bits));
+    }
+
+    inline FixedPoint64 &FixedPoint64::operator+=(const FixedPoint64 &a) { return *this = *this + a; }
+    inline FixedPoint64 &FixedPoint64::operator-=(const FixedPoint64 &a) { return *this = *this - a; }
+    inline FixedPoint64 &FixedPoint64::operator*=(const FixedPoint64 &a) { return *this = *this * a; }
+    inline FixedPoint64 &FixedPoint64::operator/=(const FixedPoint64 &a) { return *this = *this / a; }
+
+    // comparison (as the representatives in [0, 1))
+
+    inline bool operator==(const FixedPoint64 &a, const FixedPoint64 &b) { return a.bits == b.bits; }
+    inline std::strong_ordering operator<=>(const FixedPoint64 &a, const FixedPoint64 &b) { return a.bits <=> b.bits; }
+
+    // mixed operations with built-in arithmetic types
+    // (exact matches, so that they are preferred to the built-in operators through operator double())
+    // integers multiply exactly (n x is the toral endomorphism), the other operations go through FixedPoint64(double)
+
+    template <BuiltinArithmetic T>
+    FixedPoint64 operator+(const FixedPoint64 &a, T b) { return a + FixedPoint64(static_cast<double>(b)); }
+    template <BuiltinArithmetic T>
+    FixedPoint64 operator+(T a, const FixedPoint64 &b) { return FixedPoint64(static_cast<double>(a)) + b; }
+    template <BuiltinArithmetic T>
+    FixedPoint64 operator-(const FixedPoint64 &a, T b) { return a - FixedPoint64(static_cast<double>(b)); }
+    template <BuiltinArithmetic T>
+    FixedPoint64 operator-(T a, const FixedPoint64 &b) { return FixedPoint64(static_cast<double>(a)) - b; }
+
+    template <BuiltinArithmetic T>
+    FixedPoint64 operator*(const FixedPoint64 &a, T b)
+    {
+        if constexpr (std::integral<T>)
+            return FixedPoint64::fromBits(a.bits * static_cast<std::uint64_t>(b));
+        else
+            return FixedPoint64(static_cast<double>(a) * static_cast<double>(b));
+    }
+    template <BuiltinArithmetic T>
+    FixedPoint64 operator*(T a, const FixedPoint64 &b) { return b * a; }
+
+    template <BuiltinArithmetic T>
+    FixedPoint64 operator/(const FixedPoint64 &a, T b) { return FixedPoint64(static_cast<double>(a) / static_cast<double>(b)); }
+    template <BuiltinArithmetic T>
+    FixedPoint64 operator/(T a, const FixedPoint64 &b) { return FixedPoint64(static_cast<double>(a) / static_cast<double>(b)); }
+
+    template <BuiltinArithmetic T>
+    bool operator==(const FixedPoint64 &a, T b) { return static_cast<double>(a) == static_cast<double>(b); }
+    template <BuiltinArithmetic T>
+    auto operator<=>(const FixedPoint64 &a, T b) { return static_cast<double>(a) <=> static_cast<double>(b); }
+
+    // the functions required by Real (every value is already reduced)
+
+    inline FixedPoint64 mod1(FixedPoint64 a)
+    {
+        return a;
+    }
+
+    inline NaturalNumber floor(FixedPoint64)
+    {
+        return 0;
+    }
+
+    // FixedPoint64 represents only R/Z, so Torus::measure, the integrals, INVERSE and the digits (continuedFraction) are not defined for it
+    // (evaluate the maps in double instead, e.g. fixedPointTransformation<n>([](array<double, n> x) { return INVERSE(x); }))
+    template <>
+    inline constexpr bool isReducedMod1<FixedPoint64> = true;
+
+    // the index of the cell containing a when [0, 1) is divided into N cells, computed exactly (used by Histogram)
+    inline size_t cellIndex(FixedPoint64 a, size_t N)
+    {
+        return a.cell(N);
+    }
+
+    template <size_t n>
+    using FPTorus = Torus<FixedPoint64, n>;
+
+    // conversion at the boundary of the maps which are computed in floating point
+
+    template <Real R, size_t n>
+    FPTorus<n> toFixedPoint(const Torus<R, n> &point)
+    {
+        FPTorus<n> res;
+        size_t i;
+        for (i = 0; i < n; ++i)
+        {
+            res.coordinate[i] = FixedPoint64(static_cast<double>(point.coordinate[i]));
+        }
+
+        return res;
+    }
+
+    template <Real R, size_t n>
+    Torus<R, n> fromFixedPoint(const FPTorus<n> &point)
+    {
+        Torus<R, n> res;
+        size_t i;
+        for (i = 0; i < n; ++i)
+        {
+            res.coordinate[i] = static_cast<R>(static_cast<double>(point.coordinate[i]));
+        }
+
+        return res;
+    }
+
+    // the transformation on FPTorus<n> which evaluates f : array<double, n> -> array<double, n> in double
+    // e.g. makeStaticGGT<FixedPoint64, n>(fixedPointTransformation<n>(f))
+    template <size_t n, typename F>
+    auto fixedPointTransformation(F f)
+    {
+        return [f](array<FixedPoint64, n> x) -> array<FixedPoint64, n>
+        {
+            array<double, n> y;
+            array<FixedPoint64, n> res;
+            size_t i;
+
+            for (i = 0; i < n; ++i)
+            {
+                y[i] = static_cast<double>(x[i]);
+            }
+            y = f(y);
+            for (i = 0; i < n; ++i)
+            {
+                res[i] = FixedPoint64(y[i]);
+            }
+
+            return res;
+        };
+    }
+}
@@ -1,172 +1,573 @@
 #pragma once
 
 #include "torus.hpp"
+#include "histogram.hpp"
+#include "batch.hpp"
+#include "random.hpp"
+#include "orbit.hpp"
+#include "degeneracy.hpp"
 #include "natural.hpp"
 #include <vector>
 #include <functional>
 #include <random>
 #include <tuple>
+#include <concepts>
+#include <cstdint>
+#include <algorithm>
+#include <thread>
+#include <iterator>
 
 namespace GaussSim
 {
     using std::tuple;
     using std::vector;
 
-    // generalized gauss transformation
-    template <Real R, size_t n>
-    class GGT
+    // a transformation on the n-dimensional real space, i.e. a callable array<R, n> -> array<R, n>
+    template <typename F, typename R, size_t n>
+    concept Transformation = requires(const F f, array<R, n> x) {
+        { f(x) } -> std::convertible_to<array<R, n>>;
+    };
+
+    // generalized gauss transformation whose original transformation is the callable of type F
+    // F is known at compile time, so the transformation can be inlined into the loops below
+    template <Real R, size_t n, Transformation<R, n> F>
+    class StaticGGT
     {
     protected:
-        std::function<array<R, n>(array<R, n>)> originalTransformation;
-        std::function<Torus<R, n>(Torus<R, n>)> transformation;
+        F originalTransformation;
+
+        static bool isInRect(Torus<R, n> rectBL, Torus<R, n> rectTR, Torus<R, n> point);
+
+        // iterate the orbit under the guard, and call consume(point) for each point of the orbit
+        // reset() is called when the orbit is discarded (DP_RESTART)
+        // returns the number of consumed points (less than numOfIteration if truncated)
+        template <typename Consume, typename Reset>
+        size_t walkOrbit(Torus<R, n> initial, size_t numOfIteration, const DegeneracyGuard &guard, Consume consume, Reset reset) const;
+        // the same, but step(point) consumes the point and returns the next point of the orbit
+        // (for the consumers which evaluate the transformation themselves, e.g. continuedFraction)
+        template <typename Step, typename Reset>
+        size_t walkOrbitBy(Torus<R, n> initial, size_t numOfIteration, const DegeneracyGuard &guard, Step step, Reset reset) const;
 
     public:
-        GGT() {}
-        GGT(std::function<array<R, n>(array<R, n>)> original);
-        GGT(const GGT<R, n> &);
+        StaticGGT() {}
+        StaticGGT(F original) : originalTransformation(original) {}
 
         // set N = numOfIteration, x = initial, then orbit() = {x, T(x), T^2(x), ..., T^{N-1}(x)} (N elements)
         vector<Torus<R, n>> orbit(Torus<R, n> initial, size_t numOfIteration) const;
-        vector<array<NaturalNumber, n>> continuedFraction(Torus<R, n> target, size_t depth) const;
+        // orbit() with the detection of degenerate orbits (see DegeneracyPolicy)
+        vector<Torus<R, n>> orbit(Torus<R, n> initial, size_t numOfIteration, const DegeneracyGuard &guard) const;
+        // the same points as orbit(), but computed on demand (O(1) memory)
+        // (there is no guarded view: the points are already consumed when a degeneracy is detected, so they cannot be discarded for DP_RESTART;
+        // use orbit() or the consumers below with a DegeneracyGuard)
+        OrbitView<R, n, StaticGGT<R, n, F>> orbitView(Torus<R, n> initial, size_t numOfIteration) const;
+        // the digits floor(T'(x)), floor(T'(T(x))), ... of the expansion of x = target (T': the original transformation)
+        // each step evaluates the original transformation only once, for both the digit and the next point
+        // (not defined if R is reduced mod 1, e.g. FixedPoint64: its floor is always 0)
+        vector<array<NaturalNumber, n>> continuedFraction(Torus<R, n> target, size_t depth) const
+            requires(!isReducedMod1<R>);
+        // continuedFraction() with the detection of degenerate orbits (see DegeneracyPolicy)
+        // DP_RESTART expands a fresh point instead, and DP_TRUNCATE returns fewer than depth digits
+        vector<array<NaturalNumber, n>> continuedFraction(Torus<R, n> target, size_t depth, const DegeneracyGuard &guard) const
+            requires(!isReducedMod1<R>);
+        // streaming version: the digits are written to out one by one (e.g. std::back_inserter, std::ostream_iterator)
+        template <std::output_iterator<array<NaturalNumber, n>> OutputIt>
+        OutputIt continuedFraction(Torus<R, n> target, size_t depth, OutputIt out) const
+            requires(!isReducedMod1<R>);
+        // batch version: the k-th entry is the expansion of the k-th point of targets
+        // the points are expanded together (in parallel with OpenMP)
+        vector<vector<array<NaturalNumber, n>>> continuedFraction(const TorusBatch<R, n> &targets, size_t depth) const
+            requires(!isReducedMod1<R>);
 
         double frequencyOfOrbit(Torus<R, n> rectBL, Torus<R, n> rectTR, Torus<R, n> initial, size_t depth) const;
-        double frequencyOfOrbit(Torus<R, n> rectBL, Torus<R, n> rectTR, vector<Torus<R, n>> _orbit) const;
-        double frequencyOfRandomOrbits(Torus<R, n> rectBL, Torus<R, n> rectTR, size_t depth, size_t numOfExperiments) const;
+        // (0 if the orbit is truncated before its first point)
+        double frequencyOfOrbit(Torus<R, n> rectBL, Torus<R, n> rectTR, Torus<R, n> initial, size_t depth, const DegeneracyGuard &guard) const;
+        // _orbit: any range of points, e.g. vector<Torus<R, n>> or orbitView()
+        template <OrbitRange<R, n> Orbit>
+        double frequencyOfOrbit(Torus<R, n> rectBL, Torus<R, n> rectTR, Orbit &&_orbit) const;
+        // the mean frequency of numOfExperiments orbits from random initial points
+        // the experiments run in parallel (with OpenMP), and the k-th initial point is drawn from randomStream(seed, k),
+        // so the result depends only on seed, not on the number of threads
+        double frequencyOfRandomOrbits(Torus<R, n> rectBL, Torus<R, n> rectTR, size_t depth, size_t numOfExperiments, std::uint64_t seed = 0) const;
+        // the frequencies of the experiments first, ..., first + numOfExperiments - 1 of frequencyOfRandomOrbits
+        // (the k-th entry is the frequency of the orbit from randomStream(seed, first + k)), so that a run can be split into shards
+        vector<double> frequenciesOfRandomOrbits(Torus<R, n> rectBL, Torus<R, n> rectTR, size_t depth, size_t first, size_t numOfExperiments, std::uint64_t seed = 0) const;
+
+        // the histogram of the orbit on the grid with gridShape[i] cells along the i-th axis (one pass over the orbit)
+        Histogram<n> densityHistogram(Torus<R, n> initial, size_t depth, array<size_t, n> gridShape) const;
+        Histogram<n> densityHistogram(Torus<R, n> initial, size_t depth, array<size_t, n> gridShape, const DegeneracyGuard &guard) const;
+        template <OrbitRange<R, n> Orbit>
+        Histogram<n> densityHistogram(Orbit &&_orbit, array<size_t, n> gridShape) const;
+
+        // batch versions: the orbits of all points of the batch are advanced together
+        // apply the transformation to every point of the batch
+        void advance(TorusBatch<R, n> &batch) const;
+        // the frequencies of the orbits of the points of initial (k-th entry = the frequency of the k-th orbit)
+        vector<double> frequencyOfOrbits(Torus<R, n> rectBL, Torus<R, n> rectTR, TorusBatch<R, n> initial, size_t depth) const;
+        // the histogram of all the orbits of the points of initial
+        Histogram<n> densityHistogram(TorusBatch<R, n> initial, size_t depth, array<size_t, n> gridShape) const;
 
         Torus<R, n> operator()(Torus<R, n> torus) const;
         array<R, n> operator()(array<R, n> coor) const;
     };
 
-    template <Real R, size_t n>
-    GGT<R, n>::GGT(std::function<array<R, n>(array<R, n>)> original)
-        : originalTransformation(original)
+    template <Real R, size_t n, typename F>
+    StaticGGT<R, n, F> makeStaticGGT(F original)
     {
-        transformation = [&](Torus<R, n> t)
-        {
-            return Torus<R, n>(originalTransformation(t.coordinate));
-        };
+        return StaticGGT<R, n, F>(original);
     }
 
+    // generalized gauss transformation whose original transformation is given at runtime
     template <Real R, size_t n>
-    GGT<R, n>::GGT(const GGT<R, n> &ggt)
-        : originalTransformation(ggt.originalTransformation), transformation(ggt.transformation) {}
+    class GGT : public StaticGGT<R, n, std::function<array<R, n>(array<R, n>)>>
+    {
+    public:
+        GGT() {}
+        GGT(std::function<array<R, n>(array<R, n>)> original)
+            : StaticGGT<R, n, std::function<array<R, n>(array<R, n>)>>(original) {}
+        GGT(const GGT<R, n> &ggt)
+            : StaticGGT<R, n, std::function<array<R, n>(array<R, n>)>>(ggt) {}
+    };
 
-    template <Real R, size_t n>
-    vector<Torus<R, n>> GGT<R, n>::orbit(Torus<R, n> initial, size_t numOfIteration) const
+    template <Real R, size_t n, Transformation<R, n> F>
+    vector<Torus<R, n>> StaticGGT<R, n, F>::orbit(Torus<R, n> initial, size_t numOfIteration) const
     {
+        GAUSSSIM_PHASE(IP_ORBIT);
+
         vector<Torus<R, n>> orb;
         Torus<R, n> next(initial, false);
 
-        int i;
+        orb.reserve(numOfIteration);
+        GAUSSSIM_COUNT(IC_ALLOCATION, 1);
+        GAUSSSIM_COUNT(IC_ALLOCATED_BYTES, numOfIteration * sizeof(Torus<R, n>));
+
+        size_t i;
         for (i = 0; i < numOfIteration; ++i)
         {
             orb.push_back(next);
-            next = transformation(next);
+            next = (*this)(next);
         }
 
         return orb;
     }
 
-    template <Real R, size_t n>
-    vector<array<NaturalNumber, n>> GGT<R, n>::continuedFraction(Torus<R, n> arr, size_t depth) const
+    template <Real R, size_t n, Transformation<R, n> F>
+    bool StaticGGT<R, n, F>::isInRect(Torus<R, n> rectBL, Torus<R, n> rectTR, Torus<R, n> point)
     {
-        vector<array<NaturalNumber, n>> cf;
+        GAUSSSIM_COUNT(IC_RECT_TEST, 1);
 
-        auto orb = this->orbit(arr, depth);
+        int i;
+        for (i = 0; i < n; ++i)
+        {
+            if (!(rectBL[i] <= point[i] && point[i] <= rectTR[i]))
+                return false;
+        }
+
+        return true;
+    }
+
+    template <Real R, size_t n, Transformation<R, n> F>
+    template <typename Consume, typename Reset>
+    size_t StaticGGT<R, n, F>::walkOrbit(Torus<R, n> initial, size_t numOfIteration, const DegeneracyGuard &guard, Consume consume, Reset reset) const
+    {
+        return this->walkOrbitBy(
+            initial, numOfIteration, guard,
+            [&](const Torus<R, n> &point)
+            {
+                consume(point);
+                return (*this)(point);
+            },
+            reset);
+    }
+
+    template <Real R, size_t n, Transformation<R, n> F>
+    template <typename Step, typename Reset>
+    size_t StaticGGT<R, n, F>::walkOrbitBy(Torus<R, n> initial, size_t numOfIteration, const DegeneracyGuard &guard, Step step, Reset reset) const
+    {
+        CycleDetector<R, n> detector(guard.maxPeriod);
+        Torus<R, n> next(initial, false);
+        size_t i = 0, restarts = 0;
 
-        for (auto itr = orb.begin(); itr != orb.end(); ++itr)
+        while (i < numOfIteration)
         {
-            cf.push_back(FloorArray<R, n>(originalTransformation(itr->coordinate)));
+            if (guard.policy != DP_IGNORE && detector.feed(next))
+            {
+                if (guard.policy == DP_TRUNCATE)
+                    return i;
+                if (guard.policy == DP_ABORT || restarts == guard.maxRestarts)
+                    throw DegenerateOrbitError(i, detector.period());
+
+                // DP_RESTART: start again from a fresh point
+                GAUSSSIM_COUNT(IC_RESTART, 1);
+                auto engine = randomStream(guard.seed, restarts++);
+                next = randomTorus<R, n>(engine);
+                detector.reset();
+                reset();
+                i = 0;
+                continue;
+            }
+
+            next = step(next);
+            ++i;
         }
 
+        return numOfIteration;
+    }
+
+    template <Real R, size_t n, Transformation<R, n> F>
+    vector<Torus<R, n>> StaticGGT<R, n, F>::orbit(Torus<R, n> initial, size_t numOfIteration, const DegeneracyGuard &guard) const
+    {
+        GAUSSSIM_PHASE(IP_ORBIT);
+
+        vector<Torus<R, n>> orb;
+
+        orb.reserve(numOfIteration);
+        GAUSSSIM_COUNT(IC_ALLOCATION, 1);
+        GAUSSSIM_COUNT(IC_ALLOCATED_BYTES, numOfIteration * sizeof(Torus<R, n>));
+        this->walkOrbit(
+            initial, numOfIteration, guard,
+            [&](const Torus<R, n> &point)
+            { orb.push_back(point); },
+            [&]()
+            { orb.clear(); });
+
+        return orb;
+    }
+
+    template <Real R, size_t n, Transformation<R, n> F>
+    OrbitView<R, n, StaticGGT<R, n, F>> StaticGGT<R, n, F>::orbitView(Torus<R, n> initial, size_t numOfIteration) const
+    {
+        return OrbitView<R, n, StaticGGT<R, n, F>>(*this, initial, numOfIteration);
+    }
+
+    template <Real R, size_t n, Transformation<R, n> F>
+    vector<array<NaturalNumber, n>> StaticGGT<R, n, F>::continuedFraction(Torus<R, n> arr, size_t depth) const
+        requires(!isReducedMod1<R>)
+    {
+        vector<array<NaturalNumber, n>> cf;
+
+        cf.reserve(depth);
+        GAUSSSIM_COUNT(IC_ALLOCATION, 1);
+        GAUSSSIM_COUNT(IC_ALLOCATED_BYTES, depth * sizeof(array<NaturalNumber, n>));
+        this->continuedFraction(arr, depth, std::back_inserter(cf));
+
         return cf;
     }
 
-    template <Real R, size_t n>
-    double GGT<R, n>::frequencyOfOrbit(Torus<R, n> rectBL, Torus<R, n> rectTR, Torus<R, n> initial, size_t depth) const
+    template <Real R, size_t n, Transformation<R, n> F>
+    vector<array<NaturalNumber, n>> StaticGGT<R, n, F>::continuedFraction(Torus<R, n> arr, size_t depth, const DegeneracyGuard &guard) const
+        requires(!isReducedMod1<R>)
     {
-        auto orb = this->orbit(initial, depth);
-        int i;
-        bool in;
-        size_t timesOrbitComeToRect = 0;
+        GAUSSSIM_PHASE(IP_CONTINUED_FRACTION);
+
+        vector<array<NaturalNumber, n>> cf;
+
+        cf.reserve(depth);
+        GAUSSSIM_COUNT(IC_ALLOCATION, 1);
+        GAUSSSIM_COUNT(IC_ALLOCATED_BYTES, depth * sizeof(array<NaturalNumber, n>));
+        this->walkOrbitBy(
+            arr, depth, guard,
+            [&](const Torus<R, n> &point)
+            {
+                // one evaluation for both the digit and the next point
+                GAUSSSIM_COUNT(IC_MAP, 1);
+                array<R, n> image = originalTransformation(point.coordinate);
+                cf.push_back(FloorArray<R, n>(image));
+                return Torus<R, n>(image);
+            },
+            [&]()
+            { cf.clear(); });
+
+        return cf;
+    }
 
-        for (auto itr = orb.begin(); itr != orb.end(); ++itr)
+    template <Real R, size_t n, Transformation<R, n> F>
+    template <std::output_iterator<array<NaturalNumber, n>> OutputIt>
+    OutputIt StaticGGT<R, n, F>::continuedFraction(Torus<R, n> arr, size_t depth, OutputIt out) const
+        requires(!isReducedMod1<R>)
+    {
+        GAUSSSIM_PHASE(IP_CONTINUED_FRACTION);
+        GAUSSSIM_COUNT(IC_MAP, depth);
+
+        Torus<R, n> next(arr, false);
+        array<R, n> image;
+        size_t i;
+
+        for (i = 0; i < depth; ++i)
         {
-            in = true;
+            image = originalTransformation(next.coordinate);
+            *out = FloorArray<R, n>(image);
+            ++out;
+            next = Torus<R, n>(image);
+        }
+
+        return out;
+    }
+
+    template <Real R, size_t n, Transformation<R, n> F>
+    vector<vector<array<NaturalNumber, n>>> StaticGGT<R, n, F>::continuedFraction(const TorusBatch<R, n> &targets, size_t depth) const
+        requires(!isReducedMod1<R>)
+    {
+        GAUSSSIM_PHASE(IP_CONTINUED_FRACTION);
+
+        const size_t K = targets.size();
+        const size_t numOfChunks = (K + defaultBatchSize - 1) / defaultBatchSize;
+        vector<vector<array<NaturalNumber, n>>> cf(K, vector<array<NaturalNumber, n>>(depth));
+        size_t c;
+
+        GAUSSSIM_COUNT(IC_MAP, K * depth);
+        GAUSSSIM_COUNT(IC_ALLOCATION, K);
+        GAUSSSIM_COUNT(IC_ALLOCATED_BYTES, K * depth * sizeof(array<NaturalNumber, n>));
+
+#pragma omp parallel for schedule(dynamic)
+        for (c = 0; c < numOfChunks; ++c)
+        {
+            size_t first = c * defaultBatchSize, size = std::min(defaultBatchSize, K - first);
+            array<R, n> x;
+            size_t i, k, t;
+
+            // the chunk of the targets in structure-of-arrays layout
+            TorusBatch<R, n> chunk(size);
             for (i = 0; i < n; ++i)
             {
-                if (!(rectBL[i] <= (*itr)[i] && (*itr)[i] <= rectTR[i]))
+                std::copy(targets.lanes[i].begin() + first, targets.lanes[i].begin() + first + size, chunk.lanes[i].begin());
+            }
+
+            for (t = 0; t < depth; ++t)
+            {
+                for (k = 0; k < size; ++k)
                 {
-                    // if not in the set
-                    in = false;
-                    break;
+                    for (i = 0; i < n; ++i)
+                    {
+                        x[i] = chunk.lanes[i][k];
+                    }
+                    x = originalTransformation(x);
+                    for (i = 0; i < n; ++i)
+                    {
+                        cf[first + k][t][i] = FLOOR<R>(x[i]);
+                        chunk.lanes[i][k] = MOD1<R>(x[i]);
+                    }
                 }
             }
-            if (in)
+        }
+
+        return cf;
+    }
+
+    template <Real R, size_t n, Transformation<R, n> F>
+    double StaticGGT<R, n, F>::frequencyOfOrbit(Torus<R, n> rectBL, Torus<R, n> rectTR, Torus<R, n> initial, size_t depth) const
+    {
+        return this->frequencyOfOrbit(rectBL, rectTR, this->orbitView(initial, depth));
+    }
+
+    template <Real R, size_t n, Transformation<R, n> F>
+    template <OrbitRange<R, n> Orbit>
+    double StaticGGT<R, n, F>::frequencyOfOrbit(Torus<R, n> rectBL, Torus<R, n> rectTR, Orbit &&_orbit) const
+    {
+        GAUSSSIM_PHASE(IP_FREQUENCY);
+
+        size_t depth = 0;
+        size_t timesOrbitComeToRect = 0;
+
+        for (const auto &point : _orbit)
+        {
+            ++depth;
+            if (isInRect(rectBL, rectTR, point))
                 ++timesOrbitComeToRect;
         }
 
         return (double)timesOrbitComeToRect / depth;
     }
 
-    template <Real R, size_t n>
-    double GGT<R, n>::frequencyOfOrbit(Torus<R, n> rectBL, Torus<R, n> rectTR, vector<Torus<R, n>> _orbit) const
+    template <Real R, size_t n, Transformation<R, n> F>
+    double StaticGGT<R, n, F>::frequencyOfOrbit(Torus<R, n> rectBL, Torus<R, n> rectTR, Torus<R, n> initial, size_t depth, const DegeneracyGuard &guard) const
     {
-        size_t depth = _orbit.size();
-        int i;
-        bool in;
+        GAUSSSIM_PHASE(IP_FREQUENCY);
+
         size_t timesOrbitComeToRect = 0;
+        size_t walked = this->walkOrbit(
+            initial, depth, guard,
+            [&](const Torus<R, n> &point)
+            {
+                if (isInRect(rectBL, rectTR, point))
+                    ++timesOrbitComeToRect;
+            },
+            [&]()
+            { timesOrbitComeToRect = 0; });
 
-        for (auto itr = _orbit.begin(); itr != _orbit.end(); ++itr)
+        if (walked == 0)
+            return 0;
+        return (double)timesOrbitComeToRect / walked;
+    }
+
+    template <Real R, size_t n, Transformation<R, n> F>
+    double StaticGGT<R, n, F>::frequencyOfRandomOrbits(Torus<R, n> rectBL, Torus<R, n> rectTR, size_t depth, size_t numOfExperiments, std::uint64_t seed) const
+    {
+        vector<double> frequencies = frequenciesOfRandomOrbits(rectBL, rectTR, depth, 0, numOfExperiments, seed);
+        double sumOfFrequency = 0;
+        size_t k;
+
+        // sum up in the fixed order
+        for (k = 0; k < numOfExperiments; ++k)
+        {
+            sumOfFrequency += frequencies[k];
+        }
+
+        return sumOfFrequency / numOfExperiments;
+    }
+
+    template <Real R, size_t n, Transformation<R, n> F>
+    vector<double> StaticGGT<R, n, F>::frequenciesOfRandomOrbits(Torus<R, n> rectBL, Torus<R, n> rectTR, size_t depth, size_t first, size_t numOfExperiments, std::uint64_t seed) const
+    {
+        // small enough to give every thread several batches (the result does not depend on the batch size)
+        const size_t numOfThreads = std::max(1u, std::thread::hardware_concurrency());
+        const size_t batchSize = std::clamp<size_t>(numOfExperiments / (4 * numOfThreads) + 1, 1, defaultBatchSize);
+        const size_t numOfBatches = (numOfExperiments + batchSize - 1) / batchSize;
+        vector<double> frequencies(numOfExperiments, 0);
+        size_t b;
+
+#pragma omp parallel for schedule(dynamic)
+        for (b = 0; b < numOfBatches; ++b)
+        {
+            size_t offset = b * batchSize;
+            size_t size = std::min(batchSize, numOfExperiments - offset);
+            auto batchFrequencies = this->frequencyOfOrbits(rectBL, rectTR, randomBatch<R, n>(seed, first + offset, size), depth);
+
+            std::copy(batchFrequencies.begin(), batchFrequencies.end(), frequencies.begin() + offset);
+        }
+
+        return frequencies;
+    }
+
+    template <Real R, size_t n, Transformation<R, n> F>
+    Histogram<n> StaticGGT<R, n, F>::densityHistogram(Torus<R, n> initial, size_t depth, array<size_t, n> gridShape) const
+    {
+        return densityHistogram(this->orbitView(initial, depth), gridShape);
+    }
+
+    template <Real R, size_t n, Transformation<R, n> F>
+    Histogram<n> StaticGGT<R, n, F>::densityHistogram(Torus<R, n> initial, size_t depth, array<size_t, n> gridShape, const DegeneracyGuard &guard) const
+    {
+        GAUSSSIM_PHASE(IP_HISTOGRAM);
+
+        Histogram<n> hist(gridShape);
+
+        this->walkOrbit(
+            initial, depth, guard,
+            [&](const Torus<R, n> &point)
+            { hist.add(point); },
+            [&]()
+            { hist = Histogram<n>(gridShape); });
+
+        return hist;
+    }
+
+    template <Real R, size_t n, Transformation<R, n> F>
+    template <OrbitRange<R, n> Orbit>
+    Histogram<n> StaticGGT<R, n, F>::densityHistogram(Orbit &&_orbit, array<size_t, n> gridShape) const
+    {
+        GAUSSSIM_PHASE(IP_HISTOGRAM);
+
+        Histogram<n> hist(gridShape);
+
+        for (const auto &point : _orbit)
+        {
+            hist.template add<R>(point);
+        }
+
+        return hist;
+    }
+
+    template <Real R, size_t n, Transformation<R, n> F>
+    void StaticGGT<R, n, F>::advance(TorusBatch<R, n> &batch) const
+    {
+        array<R *, n> lanes;
+        array<R, n> x;
+        size_t i, k;
+
+        GAUSSSIM_COUNT(IC_MAP, batch.size());
+        GAUSSSIM_COUNT(IC_ADJUST, batch.size());
+
+        for (i = 0; i < n; ++i)
+        {
+            lanes[i] = batch.lanes[i].data();
+        }
+
+        for (k = 0; k < batch.size(); ++k)
         {
-            in = true;
             for (i = 0; i < n; ++i)
             {
-                if (!(rectBL[i] <= (*itr)[i] && (*itr)[i] <= rectTR[i]))
-                {
-                    // if not in the set
-                    in = false;
-                    break;
-                }
+                x[i] = lanes[i][k];
+            }
+            x = originalTransformation(x);
+            for (i = 0; i < n; ++i)
+            {
+                lanes[i][k] = MOD1<R>(x[i]);
             }
-            if (in)
-                ++timesOrbitComeToRect;
         }
-
-        return (double)timesOrbitComeToRect / depth;
     }
 
-    template <Real R, size_t n>
-    double GGT<R, n>::frequencyOfRandomOrbits(Torus<R, n> rectBL, Torus<R, n> rectTR, size_t depth, size_t numOfExperiments) const
+    template <Real R, size_t n, Transformation<R, n> F>
+    vector<double> StaticGGT<R, n, F>::frequencyOfOrbits(Torus<R, n> rectBL, Torus<R, n> rectTR, TorusBatch<R, n> initial, size_t depth) const
     {
-        size_t i;
-        int j;
-        double sumOfFrequency = 0;
-        std::mt19937 mt32;
-        std::uniform_real_distribution<double> rndm(0, 1);
-        Torus<R, n> x;
-        for (i = 0; i < numOfExperiments; ++i)
+        GAUSSSIM_PHASE(IP_FREQUENCY);
+        GAUSSSIM_COUNT(IC_RECT_TEST, initial.size() * depth);
+
+        size_t K = initial.size();
+        vector<size_t> timesOrbitComeToRect(K, 0);
+        vector<double> frequencies(K, 0);
+        size_t i, k, t;
+        bool in;
+
+        for (t = 0; t < depth; ++t)
         {
-            for (j = 0; j < n; ++j)
+            for (k = 0; k < K; ++k)
             {
-                x[j] = rndm(mt32);
+                in = true;
+                for (i = 0; i < n; ++i)
+                {
+                    in &= (rectBL[i] <= initial.lanes[i][k]) & (initial.lanes[i][k] <= rectTR[i]);
+                }
+                timesOrbitComeToRect[k] += in;
             }
+            this->advance(initial);
+        }
 
-            sumOfFrequency += this->frequencyOfOrbit(rectBL, rectTR, x, depth);
+        for (k = 0; k < K; ++k)
+        {
+            frequencies[k] = (double)timesOrbitComeToRect[k] / depth;
         }
 
-        return sumOfFrequency / numOfExperiments;
+        return frequencies;
     }
 
-    template <Real R, size_t n>
-    Torus<R, n> GGT<R, n>::operator()(Torus<R, n> torus) const
+    template <Real R, size_t n, Transformation<R, n> F>
+    Histogram<n> StaticGGT<R, n, F>::densityHistogram(TorusBatch<R, n> initial, size_t depth, array<size_t, n> gridShape) const
+    {
+        GAUSSSIM_PHASE(IP_HISTOGRAM);
+
+        Histogram<n> hist(gridShape);
+        size_t t;
+
+        for (t = 0; t < depth; ++t)
+        {
+            hist.add(initial);
+            this->advance(initial);
+        }
+
+        return hist;
+    }
+
+    template <Real R, size_t n, Transformation<R, n> F>
+    Torus<R, n> StaticGGT<R, n, F>::operator()(Torus<R, n> torus) const
     {
-        return transformation(torus);
+        GAUSSSIM_COUNT(IC_MAP, 1);
+        return Torus<R, n>(originalTransformation(torus.coordinate));
     }
 
-    template <Real R, size_t n>
-    array<R, n> GGT<R, n>::operator()(array<R, n> torus) const
+    template <Real R, size_t n, Transformation<R, n> F>
+    array<R, n> StaticGGT<R, n, F>::operator()(array<R, n> torus) const
     {
+        GAUSSSIM_COUNT(IC_MAP, 1);
         return originalTransformation(torus);
     }
 
@@ -0,0 +1,171 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace GaussSim::helper::checkpoint
+{
+    using std::string;
+    using std::vector;
+
+    // the state of a run of independent experiments whose results are summed up
+    // (e.g. densitySum of xp_simulate), enough to continue the run bit-exactly
+    // (the k-th experiment draws from randomStream(seed, k), so no random engine needs to be saved)
+    struct ExperimentState
+    {
+        // the parameters of the run, a checkpoint of a run with other parameters is not resumed
+        string config;
+        // the number of completed experiments
+        size_t numOfExperiments = 0;
+        // the sum of the results of the completed experiments
+        vector<double> accumulator;
+    };
+
+    // file format (native byte order):
+    //   magic "GSCKPT02", config (length + bytes), numOfExperiments, accumulator (size + raw doubles)
+    const char checkpointMagic[8] = {'G', 'S', 'C', 'K', 'P', 'T', '0', '2'};
+
+    // write the state to path + ".tmp" and rename it to path, so that path always holds a complete checkpoint
+    // throws std::runtime_error if the file cannot be written
+    void saveState(const string &path, const ExperimentState &state);
+
+    // read the state from path
+    // returns false if there is no checkpoint or its config differs from state.config (state is not changed then)
+    // throws std::runtime_error if the file is broken
+    bool loadState(const string &path, ExperimentState &state);
+
+    // takes checkpoints at most once per interval
+    // update() only reads the clock unless a checkpoint is due, so it can be called after every experiment
+    // an empty path disables the checkpoints
+    class Checkpointer
+    {
+    protected:
+        string path;
+        std::chrono::steady_clock::duration interval;
+        std::chrono::steady_clock::time_point lastSave;
+
+    public:
+        Checkpointer(string path, double intervalSeconds = 5);
+
+        bool enabled() const { return !path.empty(); }
+
+        // load the checkpoint of the same config if it exists
+        bool resume(ExperimentState &state) const;
+        // save the state if the interval has passed since the last save (returns whether it is saved)
+        bool update(const ExperimentState &state);
+        // save the state now
+        void save(const ExperimentState &state);
+    };
+
+    namespace detail
+    {
+        inline void writeUInt64(std::ostream &out, std::uint64_t value)
+        {
+            out.write(reinterpret_cast<const char *>(&value), sizeof(value));
+        }
+
+        inline std::uint64_t readUInt64(std::istream &in)
+        {
+            std::uint64_t value = 0;
+            in.read(reinterpret_cast<char *>(&value), sizeof(value));
+            return value;
+        }
+
+        inline void writeString(std::ostream &out, const string &str)
+        {
+            writeUInt64(out, str.size());
+            out.write(str.data(), str.size());
+        }
+
+        inline string readString(std::istream &in)
+        {
+            string str(readUInt64(in), '\0');
+            in.read(str.data(), str.size());
+            return str;
+        }
+    }
+
+    inline void saveState(const string &path, const ExperimentState &state)
+    {
+        const string temporary = path + ".tmp";
+
+        {
+            std::ofstream out(temporary, std::ios::binary | std::ios::trunc);
+            out.write(checkpointMagic, sizeof(checkpointMagic));
+            detail::writeString(out, state.config);
+            detail::writeUInt64(out, state.numOfExperiments);
+            detail::writeUInt64(out, state.accumulator.size());
+            out.write(reinterpret_cast<const char *>(state.accumulator.data()), state.accumulator.size() * sizeof(double));
+            out.flush();
+            if (!out)
+                throw std::runtime_error("checkpoint: cannot write " + temporary);
+        }
+
+        std::filesystem::rename(temporary, path);
+    }
+
+    inline bool loadState(const string &path, ExperimentState &state)
+    {
+        std::ifstream in(path, std::ios::binary);
+        char magic[sizeof(checkpointMagic)];
+        ExperimentState loaded;
+
+        if (!in)
+            return false;
+
+        in.read(magic, sizeof(magic));
+        if (!in || !std::equal(magic, magic + sizeof(magic), checkpointMagic))
+            throw std::runtime_error("checkpoint: " + path + " is not a checkpoint");
+
+        loaded.config = detail::readString(in);
+        if (loaded.config != state.config)
+            return false;
+
+        loaded.numOfExperiments = detail::readUInt64(in);
+        loaded.accumulator.resize(detail::readUInt64(in));
+        in.read(reinterpret_cast<char *>(loaded.accumulator.data()), loaded.accumulator.size() * sizeof(double));
+        if (!in)
+            throw std::runtime_error("checkpoint: " + path + " is broken");
+
+        state = std::move(loaded);
+
+        return true;
+    }
+
+    inline Checkpointer::Checkpointer(string path, double intervalSeconds)
+        : path(path),
+          interval(std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(intervalSeconds))),
+          lastSave(std::chrono::steady_clock::now())
+    {
+    }
+
+    inline bool Checkpointer::resume(ExperimentState &state) const
+    {
+        return enabled() && loadState(path, state);
+    }
+
+    inline bool Checkpointer::update(const ExperimentState &state)
+    {
+        if (!enabled() || std::chrono::steady_clock::now() - lastSave < interval)
+            return false;
+
+        save(state);
+
+        return true;
+    }
+
+    inline void Checkpointer::save(const ExperimentState &state)
+    {
+        if (!enabled())
+            return;
+
+        saveState(path, state);
+        lastSave = std::chrono::steady_clock::now();
+    }
+}
@@ -0,0 +1,130 @@
+#pragma once
+
+#include <cmath>
+#include <complex>
+#include <numbers>
+#include <vector>
+
+namespace GaussSim::helper::fft
+{
+    using std::complex;
+    using std::vector;
+
+    // the smallest power of 2 which is at least size
+    inline size_t paddedSize(size_t size)
+    {
+        size_t res = 1;
+        while (res < size)
+            res <<= 1;
+
+        return res;
+    }
+
+    // iterative radix-2 fast fourier transform of a fixed size (a power of 2)
+    // the twiddle factors and the bit reversal are computed once, so that a plan can transform many lines
+    // (transform() is const and can be called from several threads)
+    // real data is transformed by packing two real sequences x, y as x + iy
+    class FFTPlan
+    {
+    protected:
+        size_t size;
+        vector<complex<double>> twiddles; // twiddles[k] = exp(-2 pi i k / size), k < size / 2
+        vector<size_t> reversed;          // reversed[k] = k with its log2(size) bits reversed
+
+    public:
+        FFTPlan(size_t size);
+
+        size_t getSize() const { return size; }
+
+        // in-place transform of size values, the inverse is normalized (divided by size)
+        void transform(complex<double> *data, bool inverse) const;
+        void transform(vector<complex<double>> &data, bool inverse) const { transform(data.data(), inverse); }
+    };
+
+    inline FFTPlan::FFTPlan(size_t size)
+        : size(size), twiddles(size / 2), reversed(size, 0)
+    {
+        size_t k, bit;
+
+        for (k = 0; k < size / 2; ++k)
+        {
+            // computed directly (not by repeated multiplication) to keep the error at the level of one rounding
+            twiddles[k] = std::polar(1.0, -2 * std::numbers::pi * k / size);
+        }
+        for (k = 1; k < size; ++k)
+        {
+            bit = size >> 1;
+            reversed[k] = reversed[k >> 1] >> 1;
+            if (k & 1)
+                reversed[k] |= bit;
+        }
+    }
+
+    inline void FFTPlan::transform(complex<double> *data, bool inverse) const
+    {
+        size_t k, half, start, j, stride;
+        complex<double> w, u, v;
+
+        for (k = 0; k < size; ++k)
+        {
+            if (k < reversed[k])
+                std::swap(data[k], data[reversed[k]]);
+        }
+
+        for (half = 1; half < size; half <<= 1)
+        {
+            stride = size / (2 * half);
+            for (start = 0; start < size; start += 2 * half)
+            {
+                for (j = 0; j < half; ++j)
+                {
+                    w = inverse ? std::conj(twiddles[j * stride]) : twiddles[j * stride];
+                    u = data[start + j];
+                    v = data[start + j + half] * w;
+                    data[start + j] = u + v;
+                    data[start + j + half] = u - v;
+                }
+            }
+        }
+
+        if (inverse)
+        {
+            const double scale = 1.0 / size;
+            for (k = 0; k < size; ++k)
+            {
+                data[k] *= scale;
+            }
+        }
+    }
+
+    // in-place 2-dimensional transform of rows x cols values in row-major order (rows, cols: powers of 2)
+    // the rows and the columns are transformed in parallel (with OpenMP)
+    inline void transform2D(vector<complex<double>> &data, size_t rows, size_t cols, bool inverse)
+    {
+        const FFTPlan rowPlan(cols), columnPlan(rows);
+        long long r, c;
+
+#pragma omp parallel for schedule(static)
+        for (r = 0; r < (long long)rows; ++r)
+        {
+            rowPlan.transform(data.data() + r * cols, inverse);
+        }
+
+#pragma omp parallel for schedule(static)
+        for (c = 0; c < (long long)cols; ++c)
+        {
+            vector<complex<double>> column(rows);
+            size_t i;
+
+            for (i = 0; i < rows; ++i)
+            {
+                column[i] = data[i * cols + c];
+            }
+            columnPlan.transform(column, inverse);
+            for (i = 0; i < rows; ++i)
+            {
+                data[i * cols + c] = column[i];
+            }
+        }
+    }
+}
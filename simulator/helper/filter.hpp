@@ -1,10 +1,29 @@
+#pragma once
+
+#include "../matrix.hpp"
+#include "../instrument.hpp"
+#include "fft.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <complex>
+#include <utility>
 #include <vector>
 
 using std::vector;
 
 namespace GaussSim::helper::filter
 {
+    using std::complex;
+
+    // kernels with more taps than this are applied by the fft (O(N log N) instead of O(N K))
+    const size_t fftKernelThreshold = 64;
+    // the same for the number of entries of the kernel of a (non-separable) 2D filter
+    const size_t fft2DKernelThreshold = 1024;
+
     // 1-dimentional local inner product filter
+    // the filtered value is the inner product of the kernel and the data around the point,
+    // divided by the sum of the weights of the kernel which are inside the data
     class LIPFilter1D
     {
         vector<double> kernel;
@@ -12,70 +31,510 @@ namespace GaussSim::helper::filter
         // if the filter is the smoothing filter of [1, 1, *1, 1, 1], then kernelcenter = 2
         // (which is the point of *, the center of the kernel matrix)
 
+        // prefix[t] = kernel[0] + ... + kernel[t - 1], for the weight sums at the edges
+        vector<double> prefix;
+
     public:
-        LIPFilter1D(vector<double> kernel, size_t kernelcenter)
-            : kernel(kernel), kernelcenter(kernelcenter) {}
+        LIPFilter1D(vector<double> kernel, size_t kernelcenter);
+
+        vector<double> applyFilter(const vector<double> &original) const;
+
+        // filter each row / each column of rows x cols data stored in row-major order
+        vector<double> applyFilterToRows(const vector<double> &original, size_t rows, size_t cols) const;
+        vector<double> applyFilterToColumns(const vector<double> &original, size_t rows, size_t cols) const;
 
-        vector<double> applyFilter(vector<double> original) const;
+        bool usesFFT() const { return kernel.size() > fftKernelThreshold; }
+
+    protected:
+        // the sum of kernel[lo], ..., kernel[hi]
+        double weightOf(long long lo, long long hi) const { return prefix[hi + 1] - prefix[lo]; }
+
+        // filter length contiguous values
+        void filterLine(const double *original, double *filtered, long long length) const;
+
+        // the fft version of filterLine
+        // the data x and its indicator 1 (of the points inside the data) are packed as x + i1 and convolved at once,
+        // so that the real part is the inner product and the imaginary part is the weight sum
+        // (the plan must be of size >= length + kernel.size() - 1, and spectrum = kernelSpectrum(plan))
+        void filterLineFFT(const double *original, double *filtered, long long length,
+                           const fft::FFTPlan &plan, const vector<complex<double>> &spectrum) const;
+        // the transform of the reversed kernel
+        vector<complex<double>> kernelSpectrum(const fft::FFTPlan &plan) const;
     };
 
-    namespace collection
+    inline LIPFilter1D::LIPFilter1D(vector<double> kernel, size_t kernelcenter)
+        : kernel(kernel), kernelcenter(kernelcenter), prefix(kernel.size() + 1, 0)
     {
-        const LIPFilter1D SmoothingFilter3({1, 1, 1}, 1);
-        const LIPFilter1D SmoothingFilter5({1, 1, 1, 1, 1}, 2);
-        const LIPFilter1D SmoothingFilter7({1, 1, 1, 1, 1, 1, 1}, 3);
-        const LIPFilter1D GaussianFilter3({0.60653, 1, 0.60653}, 1);
-        const LIPFilter1D GaussianFilter5({0.135335, 0.60653, 1, 0.60653, 0.135335}, 2);
+        size_t t;
+        for (t = 0; t < kernel.size(); ++t)
+        {
+            prefix[t + 1] = prefix[t] + kernel[t];
+        }
     }
 
-    vector<double> LIPFilter1D::applyFilter(vector<double> original) const
+    inline void LIPFilter1D::filterLine(const double *original, double *filtered, long long length) const
     {
-        size_t ormin = 0, ormax = original.size() - 1;
-        size_t i;
-        long long kmin = -kernelcenter, kmax = kernel.size() - kernelcenter - 1;
-        long long j, index;
-        double weightsum;
-        double liprod;
+        const long long K = kernel.size(), c = kernelcenter;
+        // the points whose kernel is entirely inside the data
+        const long long interiorFirst = std::min(c, length);
+        const long long interiorLast = std::max(interiorFirst, length - (K - 1 - c));
+        const double inverseTotal = 1 / weightOf(0, K - 1);
+        long long i, t, first, last;
+        double w;
+
+        std::fill(filtered, filtered + length, 0.0);
+
+        // one tap at a time over the range where original[i + t - c] exists (no branch in the inner loop)
+        for (t = 0; t < K; ++t)
+        {
+            first = std::max(0LL, c - t);
+            last = std::min(length, length + c - t);
+            w = kernel[t];
+            for (i = first; i < last; ++i)
+            {
+                filtered[i] += w * original[i + t - c];
+            }
+        }
+
+        for (i = 0; i < interiorFirst; ++i)
+        {
+            filtered[i] /= weightOf(c - i, std::min(K - 1, length - 1 - i + c));
+        }
+        for (i = interiorFirst; i < interiorLast; ++i)
+        {
+            filtered[i] *= inverseTotal;
+        }
+        for (i = interiorLast; i < length; ++i)
+        {
+            filtered[i] /= weightOf(std::max(0LL, c - i), length - 1 - i + c);
+        }
+    }
+
+    inline vector<complex<double>> LIPFilter1D::kernelSpectrum(const fft::FFTPlan &plan) const
+    {
+        vector<complex<double>> spectrum(plan.getSize(), 0);
+        size_t t;
+
+        for (t = 0; t < kernel.size(); ++t)
+        {
+            spectrum[kernel.size() - 1 - t] = kernel[t];
+        }
+        plan.transform(spectrum, false);
+
+        return spectrum;
+    }
+
+    inline void LIPFilter1D::filterLineFFT(const double *original, double *filtered, long long length,
+                                           const fft::FFTPlan &plan, const vector<complex<double>> &spectrum) const
+    {
+        // filtered[i] = sum_t kernel[t] original[i + t - c] is the (i + K - 1 - c)-th term of the convolution with the reversed kernel
+        const long long offset = (long long)kernel.size() - 1 - kernelcenter;
+        vector<complex<double>> work(plan.getSize(), 0);
+        long long i;
+
+        for (i = 0; i < length; ++i)
+        {
+            work[i] = complex<double>(original[i], 1);
+        }
+        plan.transform(work, false);
+        for (i = 0; i < (long long)work.size(); ++i)
+        {
+            work[i] *= spectrum[i];
+        }
+        plan.transform(work, true);
+
+        for (i = 0; i < length; ++i)
+        {
+            filtered[i] = work[i + offset].real() / work[i + offset].imag();
+        }
+    }
+
+    inline vector<double> LIPFilter1D::applyFilter(const vector<double> &original) const
+    {
+        GAUSSSIM_PHASE(IP_FILTER);
+
+        vector<double> filtered(original.size(), 0);
+
+        if (usesFFT())
+        {
+            const fft::FFTPlan plan(fft::paddedSize(original.size() + kernel.size() - 1));
+            filterLineFFT(original.data(), filtered.data(), original.size(), plan, kernelSpectrum(plan));
+        }
+        else
+        {
+            filterLine(original.data(), filtered.data(), original.size());
+        }
+
+        return filtered;
+    }
+
+    inline vector<double> LIPFilter1D::applyFilterToRows(const vector<double> &original, size_t rows, size_t cols) const
+    {
+        GAUSSSIM_PHASE(IP_FILTER);
 
         vector<double> filtered(original.size(), 0);
+        long long r;
 
-        for (i = 0; i < original.size(); ++i)
+        if (usesFFT())
         {
-            weightsum = 0;
-            liprod = 0;
-            for (j = kmin; j <= kmax; ++j)
+            const fft::FFTPlan plan(fft::paddedSize(cols + kernel.size() - 1));
+            const vector<complex<double>> spectrum = kernelSpectrum(plan);
+
+#pragma omp parallel for schedule(static)
+            for (r = 0; r < (long long)rows; ++r)
             {
-                index = i + j;
-                if (index < ormin || ormax < index)
-                    continue;
-                weightsum += kernel[j];
-                liprod += kernel[j] * original[index];
+                filterLineFFT(original.data() + r * cols, filtered.data() + r * cols, cols, plan, spectrum);
+            }
+
+            return filtered;
+        }
+
+#pragma omp parallel for schedule(static)
+        for (r = 0; r < (long long)rows; ++r)
+        {
+            filterLine(original.data() + r * cols, filtered.data() + r * cols, cols);
+        }
+
+        return filtered;
+    }
+
+    inline vector<double> LIPFilter1D::applyFilterToColumns(const vector<double> &original, size_t rows, size_t cols) const
+    {
+        GAUSSSIM_PHASE(IP_FILTER);
+
+        const long long K = kernel.size(), c = kernelcenter, R = rows;
+        vector<double> filtered(original.size(), 0);
+        long long r;
+
+        if (usesFFT())
+        {
+            const fft::FFTPlan plan(fft::paddedSize(rows + kernel.size() - 1));
+            const vector<complex<double>> spectrum = kernelSpectrum(plan);
+
+            // each column is gathered into a contiguous line
+#pragma omp parallel for schedule(static)
+            for (r = 0; r < (long long)cols; ++r)
+            {
+                vector<double> column(rows), filteredColumn(rows);
+                size_t i;
+
+                for (i = 0; i < rows; ++i)
+                {
+                    column[i] = original[i * cols + r];
+                }
+                filterLineFFT(column.data(), filteredColumn.data(), rows, plan, spectrum);
+                for (i = 0; i < rows; ++i)
+                {
+                    filtered[i * cols + r] = filteredColumn[i];
+                }
+            }
+
+            return filtered;
+        }
+
+        // whole rows are accumulated, so that the inner loop runs over contiguous columns
+#pragma omp parallel for schedule(static)
+        for (r = 0; r < R; ++r)
+        {
+            const long long lo = std::max(0LL, c - r), hi = std::min(K - 1, R - 1 - r + c);
+            const double inverseWeight = 1 / weightOf(lo, hi);
+            double *dst = filtered.data() + r * cols;
+            long long t;
+            size_t j;
+
+            for (t = lo; t <= hi; ++t)
+            {
+                const double *src = original.data() + (r + t - c) * cols;
+                const double w = kernel[t];
+                for (j = 0; j < cols; ++j)
+                {
+                    dst[j] += w * src[j];
+                }
+            }
+            for (j = 0; j < cols; ++j)
+            {
+                dst[j] *= inverseWeight;
             }
-            filtered[i] = liprod / weightsum;
         }
 
         return filtered;
     }
 
     // 2-dimentional local inner product filter
+    // a kernel of rank 1 (e.g. gaussian and box kernels) is applied as a row filter followed by a column filter,
+    // which gives the same values with (kn + km) instead of (kn * km) operations per point
     template <size_t kn, size_t km>
     class LIPFilter2D
     {
         Matrix<double, kn, km> kernel;
         std::pair<size_t, size_t> kernelcenter;
 
+        // kernel = columnFilter (x) rowFilter if separable
+        bool separable;
+        LIPFilter1D columnFilter, rowFilter;
+
+        // the summed area table of the kernel, for the weight sums at the edges
+        array<array<double, km + 1>, kn + 1> weightTable;
+
     public:
-        LIPFilter2D(Matrix<double, kn, km> kernel, std::pair<size_t, size_t> kernelcenter)
-            : kernel(kernel), kernelcenter(kernelcenter) {}
+        LIPFilter2D(Matrix<double, kn, km> kernel, std::pair<size_t, size_t> kernelcenter);
+
+        bool isSeparable() const { return separable; }
 
+        // the data is given as a matrix (for small data: the matrix is held by value)
         template <size_t dn, size_t dm>
         Matrix<double, dn, dm> applyFilter(Matrix<double, dn, dm> original) const;
+        // the data is rows x cols values stored in row-major order
+        vector<double> applyFilter(const vector<double> &original, size_t rows, size_t cols) const;
+
+    protected:
+        // the sum of kernel[a][b] over alo <= a <= ahi, blo <= b <= bhi
+        double weightOf(long long alo, long long ahi, long long blo, long long bhi) const;
+
+        // the row / column of the kernel through its largest entry, scaled so that their product is the kernel if it is of rank 1
+        static vector<double> factor(const Matrix<double, kn, km> &kernel, bool column);
+
+        vector<double> applyDirect(const vector<double> &original, size_t rows, size_t cols) const;
+        // the 2D version of LIPFilter1D::filterLineFFT
+        vector<double> applyFFT(const vector<double> &original, size_t rows, size_t cols) const;
     };
 
-    // あとで作る
-    // template <size_t kn, size_t km>
-    // template <size_t dn, size_t dm>
-    // Matrix<double, dn, dm> LIPFilter2D<kn, km>::applyFilter(Matrix<double, dn, dm> original) const
-    // {
-    // }
-}
\ No newline at end of file
+    template <size_t kn, size_t km>
+    LIPFilter2D<kn, km>::LIPFilter2D(Matrix<double, kn, km> kernel, std::pair<size_t, size_t> kernelcenter)
+        : kernel(kernel), kernelcenter(kernelcenter),
+          columnFilter(factor(kernel, true), kernelcenter.first), rowFilter(factor(kernel, false), kernelcenter.second)
+    {
+        const vector<double> u = factor(kernel, true), v = factor(kernel, false);
+        double scale = 0;
+        size_t a, b;
+
+        for (a = 0; a < kn; ++a)
+        {
+            for (b = 0; b < km; ++b)
+            {
+                scale = std::max(scale, std::abs(kernel.entries[a][b]));
+            }
+        }
+
+        separable = true;
+        for (a = 0; a < kn; ++a)
+        {
+            for (b = 0; b < km; ++b)
+            {
+                if (std::abs(kernel.entries[a][b] - u[a] * v[b]) > 1e-12 * scale)
+                    separable = false;
+            }
+        }
+
+        for (a = 0; a <= kn; ++a)
+        {
+            for (b = 0; b <= km; ++b)
+            {
+                weightTable[a][b] = (a == 0 || b == 0) ? 0 : kernel.entries[a - 1][b - 1] + weightTable[a - 1][b] + weightTable[a][b - 1] - weightTable[a - 1][b - 1];
+            }
+        }
+    }
+
+    template <size_t kn, size_t km>
+    vector<double> LIPFilter2D<kn, km>::factor(const Matrix<double, kn, km> &kernel, bool column)
+    {
+        size_t a, b, p = 0, q = 0;
+        vector<double> res;
+
+        for (a = 0; a < kn; ++a)
+        {
+            for (b = 0; b < km; ++b)
+            {
+                if (std::abs(kernel.entries[a][b]) > std::abs(kernel.entries[p][q]))
+                {
+                    p = a;
+                    q = b;
+                }
+            }
+        }
+
+        if (column)
+        {
+            for (a = 0; a < kn; ++a)
+            {
+                res.push_back(kernel.entries[a][q]);
+            }
+        }
+        else
+        {
+            for (b = 0; b < km; ++b)
+            {
+                res.push_back(kernel.entries[p][q] == 0 ? 0 : kernel.entries[p][b] / kernel.entries[p][q]);
+            }
+        }
+
+        return res;
+    }
+
+    template <size_t kn, size_t km>
+    double LIPFilter2D<kn, km>::weightOf(long long alo, long long ahi, long long blo, long long bhi) const
+    {
+        return weightTable[ahi + 1][bhi + 1] - weightTable[alo][bhi + 1] - weightTable[ahi + 1][blo] + weightTable[alo][blo];
+    }
+
+    template <size_t kn, size_t km>
+    vector<double> LIPFilter2D<kn, km>::applyFilter(const vector<double> &original, size_t rows, size_t cols) const
+    {
+        GAUSSSIM_PHASE(IP_FILTER);
+
+        // the weight sum over a rectangle of the kernel factorizes, so the normalizations of the two passes give the 2D one
+        if (separable)
+            return columnFilter.applyFilterToColumns(rowFilter.applyFilterToRows(original, rows, cols), rows, cols);
+
+        if (kn * km > fft2DKernelThreshold)
+            return applyFFT(original, rows, cols);
+
+        return applyDirect(original, rows, cols);
+    }
+
+    template <size_t kn, size_t km>
+    vector<double> LIPFilter2D<kn, km>::applyFFT(const vector<double> &original, size_t rows, size_t cols) const
+    {
+        const size_t P = fft::paddedSize(rows + kn - 1), Q = fft::paddedSize(cols + km - 1);
+        const size_t offsetRow = kn - 1 - kernelcenter.first, offsetColumn = km - 1 - kernelcenter.second;
+        vector<complex<double>> work(P * Q, 0), spectrum(P * Q, 0);
+        vector<double> filtered(original.size(), 0);
+        size_t i, j;
+
+        for (i = 0; i < rows; ++i)
+        {
+            for (j = 0; j < cols; ++j)
+            {
+                work[i * Q + j] = complex<double>(original[i * cols + j], 1);
+            }
+        }
+        for (i = 0; i < kn; ++i)
+        {
+            for (j = 0; j < km; ++j)
+            {
+                spectrum[(kn - 1 - i) * Q + (km - 1 - j)] = kernel.entries[i][j];
+            }
+        }
+
+        fft::transform2D(work, P, Q, false);
+        fft::transform2D(spectrum, P, Q, false);
+        for (i = 0; i < P * Q; ++i)
+        {
+            work[i] *= spectrum[i];
+        }
+        fft::transform2D(work, P, Q, true);
+
+        for (i = 0; i < rows; ++i)
+        {
+            for (j = 0; j < cols; ++j)
+            {
+                const complex<double> &value = work[(i + offsetRow) * Q + (j + offsetColumn)];
+                filtered[i * cols + j] = value.real() / value.imag();
+            }
+        }
+
+        return filtered;
+    }
+
+    template <size_t kn, size_t km>
+    vector<double> LIPFilter2D<kn, km>::applyDirect(const vector<double> &original, size_t rows, size_t cols) const
+    {
+        const long long ca = kernelcenter.first, cb = kernelcenter.second, R = rows, C = cols;
+        // the columns whose kernel is entirely inside the data horizontally
+        const long long interiorFirst = std::min(cb, C);
+        const long long interiorLast = std::max(interiorFirst, C - ((long long)km - 1 - cb));
+        vector<double> filtered(original.size(), 0);
+        long long r;
+
+#pragma omp parallel for schedule(static)
+        for (r = 0; r < R; ++r)
+        {
+            const long long alo = std::max(0LL, ca - r), ahi = std::min((long long)kn - 1, R - 1 - r + ca);
+            const double inverseWeight = 1 / weightOf(alo, ahi, 0, km - 1);
+            double *dst = filtered.data() + r * C;
+            long long a, b, j, first, last;
+
+            for (a = alo; a <= ahi; ++a)
+            {
+                const double *src = original.data() + (r + a - ca) * C;
+                for (b = 0; b < (long long)km; ++b)
+                {
+                    const double w = kernel.entries[a][b];
+                    first = std::max(0LL, cb - b);
+                    last = std::min(C, C + cb - b);
+                    for (j = first; j < last; ++j)
+                    {
+                        dst[j] += w * src[j + b - cb];
+                    }
+                }
+            }
+
+            for (j = 0; j < interiorFirst; ++j)
+            {
+                dst[j] /= weightOf(alo, ahi, cb - j, std::min((long long)km - 1, C - 1 - j + cb));
+            }
+            for (j = interiorFirst; j < interiorLast; ++j)
+            {
+                dst[j] *= inverseWeight;
+            }
+            for (j = interiorLast; j < C; ++j)
+            {
+                dst[j] /= weightOf(alo, ahi, std::max(0LL, cb - j), C - 1 - j + cb);
+            }
+        }
+
+        return filtered;
+    }
+
+    template <size_t kn, size_t km>
+    template <size_t dn, size_t dm>
+    Matrix<double, dn, dm> LIPFilter2D<kn, km>::applyFilter(Matrix<double, dn, dm> original) const
+    {
+        vector<double> data(dn * dm);
+        size_t i;
+
+        for (i = 0; i < dn; ++i)
+        {
+            std::copy(original.entries[i].begin(), original.entries[i].end(), data.begin() + i * dm);
+        }
+        data = applyFilter(data, dn, dm);
+        for (i = 0; i < dn; ++i)
+        {
+            std::copy(data.begin() + i * dm, data.begin() + (i + 1) * dm, original.entries[i].begin());
+        }
+
+        return original;
+    }
+
+    namespace collection
+    {
+        const LIPFilter1D SmoothingFilter3({1, 1, 1}, 1);
+        const LIPFilter1D SmoothingFilter5({1, 1, 1, 1, 1}, 2);
+        const LIPFilter1D SmoothingFilter7({1, 1, 1, 1, 1, 1, 1}, 3);
+        const LIPFilter1D GaussianFilter3({0.60653, 1, 0.60653}, 1);
+        const LIPFilter1D GaussianFilter5({0.135335, 0.60653, 1, 0.60653, 0.135335}, 2);
+
+        // gaussian filter with the standard deviation sigma (in points), cut off at 4 sigma
+        // (wide ones are applied by the fft; for 2D data, apply it by applyFilterToRows and applyFilterToColumns)
+        inline LIPFilter1D gaussianFilter(double sigma)
+        {
+            const long long radius = std::max(1LL, (long long)std::ceil(4 * sigma));
+            vector<double> kernel(2 * radius + 1);
+            long long t;
+
+            for (t = -radius; t <= radius; ++t)
+            {
+                kernel[t + radius] = std::exp(-0.5 * (t / sigma) * (t / sigma));
+            }
+
+            return LIPFilter1D(kernel, radius);
+        }
+
+        const LIPFilter2D<3, 3> SmoothingFilter3x3({{{{1, 1, 1}, {1, 1, 1}, {1, 1, 1}}}}, {1, 1});
+        const LIPFilter2D<5, 5> SmoothingFilter5x5({{{{1, 1, 1, 1, 1}, {1, 1, 1, 1, 1}, {1, 1, 1, 1, 1}, {1, 1, 1, 1, 1}, {1, 1, 1, 1, 1}}}}, {2, 2});
+        const LIPFilter2D<3, 3> GaussianFilter3x3({{{{0.60653 * 0.60653, 0.60653, 0.60653 * 0.60653},
+                                                     {0.60653, 1, 0.60653},
+                                                     {0.60653 * 0.60653, 0.60653, 0.60653 * 0.60653}}}},
+                                                  {1, 1});
+    }
+}
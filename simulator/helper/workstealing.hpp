@@ -0,0 +1,196 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace GaussSim::helper
+{
+    // thread pool where each worker has its own task deque
+    // a worker takes the newest task from its own deque, and steals the oldest task of another worker when it runs out,
+    // so that long and short tasks balance across the threads without a central queue
+    // tasks may submit more tasks (they go to the deque of the worker running them)
+    class WorkStealingPool
+    {
+    protected:
+        struct Worker
+        {
+            std::deque<std::function<void()>> tasks;
+            std::mutex mutex;
+        };
+
+        std::vector<std::unique_ptr<Worker>> workers;
+        std::vector<std::thread> threads;
+
+        std::mutex sleepMutex;
+        std::condition_variable wakeUp, finished;
+        std::atomic<size_t> numOfQueued{0};  // tasks in the deques
+        std::atomic<size_t> numOfPending{0}; // tasks submitted and not finished
+        std::atomic<size_t> nextWorker{0};   // round robin for the tasks submitted from outside
+        bool stopping = false;
+        std::exception_ptr error;
+
+        // the index of the worker running on this thread (-1 outside the pool)
+        static inline thread_local long long currentWorker = -1;
+        static inline thread_local const WorkStealingPool *currentPool = nullptr;
+
+        bool tryPop(size_t self, std::function<void()> &task);
+        bool trySteal(size_t self, std::function<void()> &task);
+        void run(size_t self);
+
+    public:
+        // numOfThreads = 0: std::thread::hardware_concurrency()
+        WorkStealingPool(size_t numOfThreads = 0);
+        WorkStealingPool(const WorkStealingPool &) = delete;
+        WorkStealingPool &operator=(const WorkStealingPool &) = delete;
+        ~WorkStealingPool();
+
+        size_t size() const { return workers.size(); }
+
+        void submit(std::function<void()> task);
+        // block until all the submitted tasks (and the tasks they submitted) are finished
+        // rethrows the first exception thrown by a task
+        void wait();
+    };
+
+    inline WorkStealingPool::WorkStealingPool(size_t numOfThreads)
+    {
+        size_t i;
+
+        if (numOfThreads == 0)
+            numOfThreads = std::max(1u, std::thread::hardware_concurrency());
+
+        for (i = 0; i < numOfThreads; ++i)
+        {
+            workers.push_back(std::make_unique<Worker>());
+        }
+        for (i = 0; i < numOfThreads; ++i)
+        {
+            threads.emplace_back([this, i]()
+                                 { run(i); });
+        }
+    }
+
+    inline WorkStealingPool::~WorkStealingPool()
+    {
+        {
+            std::lock_guard<std::mutex> lock(sleepMutex);
+            stopping = true;
+        }
+        wakeUp.notify_all();
+        for (auto &thread : threads)
+        {
+            thread.join();
+        }
+    }
+
+    inline void WorkStealingPool::submit(std::function<void()> task)
+    {
+        const size_t target = (currentPool == this) ? currentWorker : nextWorker++ % workers.size();
+
+        ++numOfPending;
+        {
+            // counted under sleepMutex (before the task is visible), so that a worker going to sleep cannot miss it
+            std::lock_guard<std::mutex> lock(sleepMutex);
+            ++numOfQueued;
+        }
+        {
+            std::lock_guard<std::mutex> lock(workers[target]->mutex);
+            workers[target]->tasks.push_back(std::move(task));
+        }
+        wakeUp.notify_one();
+    }
+
+    inline bool WorkStealingPool::tryPop(size_t self, std::function<void()> &task)
+    {
+        std::lock_guard<std::mutex> lock(workers[self]->mutex);
+
+        if (workers[self]->tasks.empty())
+            return false;
+        task = std::move(workers[self]->tasks.back());
+        workers[self]->tasks.pop_back();
+        --numOfQueued;
+
+        return true;
+    }
+
+    inline bool WorkStealingPool::trySteal(size_t self, std::function<void()> &task)
+    {
+        size_t k, victim;
+
+        for (k = 1; k < workers.size(); ++k)
+        {
+            victim = (self + k) % workers.size();
+            std::lock_guard<std::mutex> lock(workers[victim]->mutex);
+            if (workers[victim]->tasks.empty())
+                continue;
+            task = std::move(workers[victim]->tasks.front());
+            workers[victim]->tasks.pop_front();
+            --numOfQueued;
+
+            return true;
+        }
+
+        return false;
+    }
+
+    inline void WorkStealingPool::run(size_t self)
+    {
+        std::function<void()> task;
+
+        currentWorker = self;
+        currentPool = this;
+
+        while (true)
+        {
+            if (tryPop(self, task) || trySteal(self, task))
+            {
+                try
+                {
+                    task();
+                }
+                catch (...)
+                {
+                    std::lock_guard<std::mutex> lock(sleepMutex);
+                    if (!error)
+                        error = std::current_exception();
+                }
+                task = nullptr;
+
+                if (--numOfPending == 0)
+                {
+                    std::lock_guard<std::mutex> lock(sleepMutex);
+                    finished.notify_all();
+                }
+                continue;
+            }
+
+            std::unique_lock<std::mutex> lock(sleepMutex);
+            wakeUp.wait(lock, [this]()
+                        { return stopping || numOfQueued > 0; });
+            if (stopping && numOfQueued == 0)
+                return;
+        }
+    }
+
+    inline void WorkStealingPool::wait()
+    {
+        std::unique_lock<std::mutex> lock(sleepMutex);
+        finished.wait(lock, [this]()
+                      { return numOfPending == 0; });
+
+        if (error)
+        {
+            std::exception_ptr e = error;
+            error = nullptr;
+            std::rethrow_exception(e);
+        }
+    }
+}
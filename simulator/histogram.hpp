@@ -0,0 +1,246 @@
+#pragma once
+
+#include "torus.hpp"
+#include "batch.hpp"
+
+#include <cmath>
+#include <stdexcept>
+#include <vector>
+
+namespace GaussSim
+{
+    using std::vector;
+
+    // the index of the cell containing the coordinate x when [0, 1) is divided into N cells, or N if x is nan or inf
+    // (number types with an exact computation overload it, e.g. FixedPoint64 in fixedpoint.hpp)
+    inline size_t cellIndex(double x, size_t N)
+    {
+        size_t cell;
+
+        if (!std::isfinite(x))
+            return N;
+        if (x < 0)
+            x += 1;
+        cell = static_cast<size_t>(x * N);
+        // x * N can be rounded up to N when x is just below 1
+        if (cell >= N)
+            cell = N - 1;
+
+        return cell;
+    }
+
+    // histogram of points on the n-dimensional torus
+    // the torus is divided into shape[0] x shape[1] x ... x shape[n-1] cells of the same size,
+    // and the cell (c_0, ..., c_{n-1}) is [c_0 / shape[0], (c_0 + 1) / shape[0]) x ... (half-open)
+    // points with a nan or inf coordinate (e.g. of a degenerate orbit under DP_IGNORE) are in no cell and are not added
+    template <size_t n>
+    class Histogram
+    {
+    protected:
+        array<size_t, n> shape;
+        vector<size_t> counts; // flattened, the index of the last axis changes fastest
+        size_t numOfSamples = 0;
+
+        // the index of the cell along the axis which contains the coordinate x (shape[axis] if x is nan or inf)
+        template <Real R>
+        size_t binOf(R x, size_t axis) const { return cellIndex(x, shape[axis]); }
+
+    public:
+        Histogram() { shape.fill(0); }
+        Histogram(array<size_t, n> shape);
+        // restore a histogram from its counts (in the order of getCounts())
+        Histogram(array<size_t, n> shape, vector<size_t> counts);
+
+        // add a point to the cell containing it
+        template <Real R>
+        void add(const Torus<R, n> &point);
+        // add all points of the batch
+        template <Real R>
+        void add(const TorusBatch<R, n> &points);
+        // add count points given as coordinate lanes (lanes[i][k] = the i-th coordinate of the k-th point), without copying them
+        template <Real R>
+        void add(const array<const R *, n> &lanes, size_t count);
+
+        // the index of counts corresponding to the cell
+        size_t index(array<size_t, n> cell) const;
+        // the cell containing the point (the cell index is shape[i] along the axes where the coordinate is nan or inf)
+        template <Real R>
+        array<size_t, n> cellOf(const Torus<R, n> &point) const;
+
+        array<size_t, n> getShape() const { return shape; }
+        size_t numOfCells() const { return counts.size(); }
+        size_t getNumOfSamples() const { return numOfSamples; }
+        size_t count(array<size_t, n> cell) const { return counts[index(cell)]; }
+        const vector<size_t> &getCounts() const { return counts; }
+
+        // the normalized density on the cell, i.e. (relative frequency) / (lebesgue measure of the cell)
+        double density(array<size_t, n> cell) const;
+        // the normalized densities of all cells (in the same order as getCounts())
+        vector<double> density() const;
+
+        // merge another histogram with the same shape (an empty histogram Histogram() takes the shape of the other)
+        // throws std::invalid_argument if the shapes differ
+        Histogram<n> &operator+=(const Histogram<n> &);
+    };
+
+    template <size_t n>
+    Histogram<n>::Histogram(array<size_t, n> shape)
+        : shape(shape)
+    {
+        size_t cells = 1;
+        size_t i;
+        for (i = 0; i < n; ++i)
+        {
+            cells *= shape[i];
+        }
+        counts.assign(cells, 0);
+
+        GAUSSSIM_COUNT(IC_ALLOCATION, 1);
+        GAUSSSIM_COUNT(IC_ALLOCATED_BYTES, cells * sizeof(size_t));
+    }
+
+    template <size_t n>
+    Histogram<n>::Histogram(array<size_t, n> shape, vector<size_t> counts)
+        : Histogram(shape)
+    {
+        size_t i;
+
+        if (counts.size() != this->counts.size())
+            throw std::invalid_argument("Histogram: the number of counts does not match the shape");
+
+        this->counts = std::move(counts);
+        for (i = 0; i < this->counts.size(); ++i)
+        {
+            numOfSamples += this->counts[i];
+        }
+    }
+
+    template <size_t n>
+    size_t Histogram<n>::index(array<size_t, n> cell) const
+    {
+        size_t idx = 0;
+        size_t i;
+        for (i = 0; i < n; ++i)
+        {
+            idx = idx * shape[i] + cell[i];
+        }
+
+        return idx;
+    }
+
+    template <size_t n>
+    template <Real R>
+    array<size_t, n> Histogram<n>::cellOf(const Torus<R, n> &point) const
+    {
+        array<size_t, n> cell;
+        size_t i;
+        for (i = 0; i < n; ++i)
+        {
+            cell[i] = binOf(point.coordinate[i], i);
+        }
+
+        return cell;
+    }
+
+    template <size_t n>
+    template <Real R>
+    void Histogram<n>::add(const Torus<R, n> &point)
+    {
+        array<size_t, n> cell = cellOf(point);
+        size_t i;
+
+        for (i = 0; i < n; ++i)
+        {
+            if (cell[i] >= shape[i])
+                return;
+        }
+
+        ++counts[index(cell)];
+        ++numOfSamples;
+        GAUSSSIM_COUNT(IC_BINNED, 1);
+    }
+
+    template <size_t n>
+    template <Real R>
+    void Histogram<n>::add(const TorusBatch<R, n> &points)
+    {
+        array<const R *, n> lanes;
+        size_t i;
+        for (i = 0; i < n; ++i)
+        {
+            lanes[i] = points.lanes[i].data();
+        }
+
+        add<R>(lanes, points.size());
+    }
+
+    template <size_t n>
+    template <Real R>
+    void Histogram<n>::add(const array<const R *, n> &lanes, size_t count)
+    {
+        size_t i, k, idx, bin, added = 0;
+        for (k = 0; k < count; ++k)
+        {
+            idx = 0;
+            for (i = 0; i < n; ++i)
+            {
+                bin = binOf(lanes[i][k], i);
+                if (bin >= shape[i])
+                    break;
+                idx = idx * shape[i] + bin;
+            }
+            if (i < n)
+                continue;
+            ++counts[idx];
+            ++added;
+        }
+        numOfSamples += added;
+        GAUSSSIM_COUNT(IC_BINNED, added);
+    }
+
+    template <size_t n>
+    double Histogram<n>::density(array<size_t, n> cell) const
+    {
+        if (numOfSamples == 0)
+            return 0;
+        return (double)count(cell) / numOfSamples * counts.size();
+    }
+
+    template <size_t n>
+    vector<double> Histogram<n>::density() const
+    {
+        vector<double> res(counts.size(), 0);
+        size_t i;
+
+        if (numOfSamples == 0)
+            return res;
+
+        for (i = 0; i < counts.size(); ++i)
+        {
+            res[i] = (double)counts[i] / numOfSamples * counts.size();
+        }
+
+        return res;
+    }
+
+    template <size_t n>
+    Histogram<n> &Histogram<n>::operator+=(const Histogram<n> &hist)
+    {
+        size_t i;
+
+        if (counts.empty())
+            return *this = hist;
+        if (hist.counts.empty())
+            return *this;
+        if (hist.shape != shape)
+            throw std::invalid_argument("Histogram: the shapes of the histograms do not match");
+
+        for (i = 0; i < counts.size(); ++i)
+        {
+            counts[i] += hist.counts[i];
+        }
+        numOfSamples += hist.numOfSamples;
+
+        return *this;
+    }
+}
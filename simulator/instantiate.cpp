@@ -0,0 +1,10 @@
+// the explicit instantiations declared in instantiate.hpp
+//   g++ -std=c++20 -O2 -fopenmp -c simulator/instantiate.cpp -o instantiate.o
+// (compile it with the same flags as the programs, e.g. -fopenmp or -DGAUSSSIM_INSTRUMENT)
+
+#include "instantiate.hpp"
+
+namespace GaussSim
+{
+    GAUSSSIM_INSTANTIATE()
+}
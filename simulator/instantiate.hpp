@@ -0,0 +1,41 @@
+#pragma once
+
+#include "reconstruct.hpp"
+#include "doubledouble.hpp"
+#include "fixedpoint.hpp"
+
+#include <functional>
+
+// the common instantiations of the heavy class templates (the GGTs with std::function and ReconstructGGT
+// for double, DoubleDouble in 1 - 4 dimensions, and the GGTs of FixedPoint64) are compiled once in instantiate.cpp
+// a program including this header does not instantiate them again (extern template), and is linked with the object
+// compiled with the same flags as the program (the members with omp pragmas differ with and without -fopenmp):
+//   g++ -std=c++20 -O2 -fopenmp -c simulator/instantiate.cpp -o instantiate.o
+//   g++ -std=c++20 -O2 -fopenmp program.cpp instantiate.o
+// programs which do not include it instantiate the templates themselves as before
+// Torus, TorusBatch, Histogram and Matrix are not listed: an extern template keeps their small per-point members
+// (Torus::adjust, operator[], Histogram::add, ...) out of line, and every step of the orbits calls them
+// (member templates, e.g. Torus::integral or StaticGGT of lambdas from makeStaticGGT, are always instantiated where they are used)
+
+// declaration: extern (the declarations below) or empty (the definitions in instantiate.cpp)
+#define GAUSSSIM_INSTANTIATE_GGT(declaration, R, n)                                      \
+    declaration template class StaticGGT<R, n, std::function<array<R, n>(array<R, n>)>>; \
+    declaration template class GGT<R, n>;
+
+#define GAUSSSIM_INSTANTIATE_DIMENSION(declaration, n)          \
+    GAUSSSIM_INSTANTIATE_GGT(declaration, double, n)            \
+    declaration template class ReconstructGGT<double, n>;       \
+    GAUSSSIM_INSTANTIATE_GGT(declaration, DoubleDouble, n)      \
+    declaration template class ReconstructGGT<DoubleDouble, n>; \
+    GAUSSSIM_INSTANTIATE_GGT(declaration, FixedPoint64, n)
+
+#define GAUSSSIM_INSTANTIATE(declaration)          \
+    GAUSSSIM_INSTANTIATE_DIMENSION(declaration, 1) \
+    GAUSSSIM_INSTANTIATE_DIMENSION(declaration, 2) \
+    GAUSSSIM_INSTANTIATE_DIMENSION(declaration, 3) \
+    GAUSSSIM_INSTANTIATE_DIMENSION(declaration, 4)
+
+namespace GaussSim
+{
+    GAUSSSIM_INSTANTIATE(extern)
+}
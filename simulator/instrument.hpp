@@ -0,0 +1,465 @@
+#pragma once
+
+// instrumentation of the hot paths, compiled in only with -DGAUSSSIM_INSTRUMENT
+// (otherwise every macro below expands to nothing, and its arguments are not evaluated)
+//
+//   GAUSSSIM_COUNT(counter, k)            add k to the counter (IC_*) of this thread
+//   GAUSSSIM_PHASE(phase)                 charge the time until the end of the scope to the phase (IP_*)
+//   GAUSSSIM_INSTRUMENT_EXPERIMENT(label) print a one-line summary of this thread at the end of the scope
+//   GAUSSSIM_INSTRUMENT_RUN(label)        print a summary of all the threads at the end of the scope
+//
+// with -DGAUSSSIM_INSTRUMENT_PERF (on linux) the summaries also show the cycles, instructions and cache misses
+// read by perf_event_open ("n/a" if the kernel does not allow it, see /proc/sys/kernel/perf_event_paranoid)
+
+#ifdef GAUSSSIM_INSTRUMENT
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#if defined(GAUSSSIM_INSTRUMENT_PERF) && defined(__linux__) && __has_include(<linux/perf_event.h>)
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#define GAUSSSIM_HAS_PERF
+#endif
+
+namespace GaussSim::instrument
+{
+    using std::string;
+
+    enum Counter
+    {
+        IC_MAP,             // evaluations of the original transformation
+        IC_ADJUST,          // reductions of points mod 1 (Torus::adjust)
+        IC_RECT_TEST,       // tests whether a point is in a rectangle
+        IC_BINNED,          // points added to histograms
+        IC_RESTART,         // restarts of degenerate orbits
+        IC_ALLOCATION,      // buffers of orbits / digits / batches / histograms allocated
+        IC_ALLOCATED_BYTES, // their size
+
+        numOfCounters
+    };
+
+    enum Phase
+    {
+        IP_ORBIT,
+        IP_CONTINUED_FRACTION,
+        IP_FREQUENCY,
+        IP_HISTOGRAM,
+        IP_RECONSTRUCT,
+        IP_INTEGRAL,
+        IP_FILTER,
+
+        numOfPhases
+    };
+
+    const char *const counterNames[numOfCounters] = {
+        "map evaluations", "adjust (mod 1)", "rectangle tests", "points binned", "restarts", "allocations", "allocated bytes"};
+    const char *const phaseNames[numOfPhases] = {
+        "orbit", "continuedFraction", "frequency", "histogram", "reconstruct", "integral", "filter"};
+
+    enum Hardware
+    {
+        IH_CYCLES,
+        IH_INSTRUCTIONS,
+        IH_CACHE_MISSES,
+
+        numOfHardware
+    };
+
+    const char *const hardwareNames[numOfHardware] = {"cycles", "instructions", "cache misses"};
+
+    // the counters and the (exclusive) time of the phases, summed up over some threads
+    struct Snapshot
+    {
+        std::array<std::uint64_t, numOfCounters> counts{};
+        std::array<std::uint64_t, numOfPhases> phaseNanoseconds{};
+        std::array<std::uint64_t, numOfPhases> phaseCalls{};
+
+        Snapshot &operator+=(const Snapshot &snapshot);
+        Snapshot operator-(const Snapshot &snapshot) const;
+    };
+
+    // the counters of one thread
+    // only the thread itself writes them (with relaxed loads and stores, no locked instructions), and others may read them
+    struct ThreadCounters
+    {
+        std::array<std::atomic<std::uint64_t>, numOfCounters> counts{};
+        std::array<std::atomic<std::uint64_t>, numOfPhases> phaseNanoseconds{};
+        std::array<std::atomic<std::uint64_t>, numOfPhases> phaseCalls{};
+
+        // the innermost phase running on the thread (-1: none), and since when it is charged
+        int currentPhase = -1;
+        std::chrono::steady_clock::time_point phaseStart;
+
+        ThreadCounters();
+        ~ThreadCounters();
+
+        Snapshot snapshot() const;
+    };
+
+    // the counters of the live threads, and the sum of the counters of the finished threads
+    struct Registry
+    {
+        std::mutex mutex;
+        std::vector<const ThreadCounters *> live;
+        Snapshot retired;
+    };
+
+    inline Registry &registry()
+    {
+        static Registry reg;
+        return reg;
+    }
+
+    inline ThreadCounters &local()
+    {
+        static thread_local ThreadCounters counters;
+        return counters;
+    }
+
+    inline void add(std::atomic<std::uint64_t> &value, std::uint64_t k)
+    {
+        value.store(value.load(std::memory_order_relaxed) + k, std::memory_order_relaxed);
+    }
+
+    inline void count(Counter counter, std::uint64_t k)
+    {
+        add(local().counts[counter], k);
+    }
+
+    // the counters of this thread
+    inline Snapshot threadSnapshot()
+    {
+        return local().snapshot();
+    }
+
+    // the counters of all the threads (including the finished ones)
+    inline Snapshot snapshot()
+    {
+        Registry &reg = registry();
+        std::lock_guard<std::mutex> lock(reg.mutex);
+        Snapshot total = reg.retired;
+
+        for (const ThreadCounters *counters : reg.live)
+        {
+            total += counters->snapshot();
+        }
+
+        return total;
+    }
+
+    // charges the time of the scope to the phase
+    // phases are exclusive: while a nested phase runs (e.g. orbit inside histogram), the outer phase is not charged
+    class PhaseScope
+    {
+    protected:
+        int outer;
+
+    public:
+        PhaseScope(Phase phase);
+        ~PhaseScope();
+    };
+
+    // hardware counters of the calling thread by perf_event_open
+    // inherit: also count the threads created later (their counts are added when they finish)
+    class HardwareCounters
+    {
+    protected:
+        std::array<int, numOfHardware> fds;
+
+    public:
+        HardwareCounters(bool inherit);
+        HardwareCounters(const HardwareCounters &) = delete;
+        HardwareCounters &operator=(const HardwareCounters &) = delete;
+        ~HardwareCounters();
+
+        bool available() const { return fds[0] >= 0; }
+        std::array<std::uint64_t, numOfHardware> read() const;
+    };
+
+    // prints the counters, the phases and the hardware counters of the scope to std::cerr when it ends
+    // wholeRun = false: only this thread (an experiment on one thread), one line
+    // wholeRun = true: all the threads, one line per counter
+    class Section
+    {
+    protected:
+        string label;
+        bool wholeRun;
+        Snapshot start;
+        std::chrono::steady_clock::time_point startTime;
+        HardwareCounters hardware;
+        std::array<std::uint64_t, numOfHardware> hardwareStart{};
+
+    public:
+        Section(string label, bool wholeRun);
+        ~Section();
+
+        void print(std::ostream &out) const;
+    };
+
+    inline Snapshot &Snapshot::operator+=(const Snapshot &snapshot)
+    {
+        size_t i;
+
+        for (i = 0; i < numOfCounters; ++i)
+        {
+            counts[i] += snapshot.counts[i];
+        }
+        for (i = 0; i < numOfPhases; ++i)
+        {
+            phaseNanoseconds[i] += snapshot.phaseNanoseconds[i];
+            phaseCalls[i] += snapshot.phaseCalls[i];
+        }
+
+        return *this;
+    }
+
+    inline Snapshot Snapshot::operator-(const Snapshot &snapshot) const
+    {
+        Snapshot diff;
+        size_t i;
+
+        for (i = 0; i < numOfCounters; ++i)
+        {
+            diff.counts[i] = counts[i] - snapshot.counts[i];
+        }
+        for (i = 0; i < numOfPhases; ++i)
+        {
+            diff.phaseNanoseconds[i] = phaseNanoseconds[i] - snapshot.phaseNanoseconds[i];
+            diff.phaseCalls[i] = phaseCalls[i] - snapshot.phaseCalls[i];
+        }
+
+        return diff;
+    }
+
+    inline ThreadCounters::ThreadCounters()
+    {
+        Registry &reg = registry();
+        std::lock_guard<std::mutex> lock(reg.mutex);
+        reg.live.push_back(this);
+    }
+
+    inline ThreadCounters::~ThreadCounters()
+    {
+        Registry &reg = registry();
+        std::lock_guard<std::mutex> lock(reg.mutex);
+
+        reg.retired += snapshot();
+        std::erase(reg.live, this);
+    }
+
+    inline Snapshot ThreadCounters::snapshot() const
+    {
+        Snapshot snap;
+        size_t i;
+
+        for (i = 0; i < numOfCounters; ++i)
+        {
+            snap.counts[i] = counts[i].load(std::memory_order_relaxed);
+        }
+        for (i = 0; i < numOfPhases; ++i)
+        {
+            snap.phaseNanoseconds[i] = phaseNanoseconds[i].load(std::memory_order_relaxed);
+            snap.phaseCalls[i] = phaseCalls[i].load(std::memory_order_relaxed);
+        }
+
+        return snap;
+    }
+
+    inline PhaseScope::PhaseScope(Phase phase)
+    {
+        ThreadCounters &counters = local();
+        const auto now = std::chrono::steady_clock::now();
+
+        outer = counters.currentPhase;
+        if (outer >= 0)
+            add(counters.phaseNanoseconds[outer], std::chrono::duration_cast<std::chrono::nanoseconds>(now - counters.phaseStart).count());
+        add(counters.phaseCalls[phase], 1);
+        counters.currentPhase = phase;
+        counters.phaseStart = now;
+    }
+
+    inline PhaseScope::~PhaseScope()
+    {
+        ThreadCounters &counters = local();
+        const auto now = std::chrono::steady_clock::now();
+
+        add(counters.phaseNanoseconds[counters.currentPhase], std::chrono::duration_cast<std::chrono::nanoseconds>(now - counters.phaseStart).count());
+        counters.currentPhase = outer;
+        counters.phaseStart = now;
+    }
+
+    inline HardwareCounters::HardwareCounters(bool inherit)
+    {
+        fds.fill(-1);
+
+#ifdef GAUSSSIM_HAS_PERF
+        const std::uint64_t configs[numOfHardware] = {PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS, PERF_COUNT_HW_CACHE_MISSES};
+        size_t i;
+
+        for (i = 0; i < numOfHardware; ++i)
+        {
+            perf_event_attr attr{};
+            attr.type = PERF_TYPE_HARDWARE;
+            attr.size = sizeof(attr);
+            attr.config = configs[i];
+            attr.exclude_kernel = 1;
+            attr.exclude_hv = 1;
+            attr.inherit = inherit;
+
+            fds[i] = (int)syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+            if (fds[i] < 0)
+            {
+                // all or nothing
+                for (int &fd : fds)
+                {
+                    if (fd >= 0)
+                        close(fd);
+                    fd = -1;
+                }
+                return;
+            }
+        }
+#else
+        (void)inherit;
+#endif
+    }
+
+    inline HardwareCounters::~HardwareCounters()
+    {
+#ifdef GAUSSSIM_HAS_PERF
+        for (int fd : fds)
+        {
+            if (fd >= 0)
+                close(fd);
+        }
+#endif
+    }
+
+    inline std::array<std::uint64_t, numOfHardware> HardwareCounters::read() const
+    {
+        std::array<std::uint64_t, numOfHardware> values{};
+
+#ifdef GAUSSSIM_HAS_PERF
+        size_t i;
+        for (i = 0; i < numOfHardware; ++i)
+        {
+            if (fds[i] < 0 || ::read(fds[i], &values[i], sizeof(values[i])) != sizeof(values[i]))
+                values[i] = 0;
+        }
+#endif
+
+        return values;
+    }
+
+    inline Section::Section(string label, bool wholeRun)
+        : label(label), wholeRun(wholeRun),
+          start(wholeRun ? snapshot() : threadSnapshot()),
+          startTime(std::chrono::steady_clock::now()),
+          hardware(wholeRun)
+    {
+        hardwareStart = hardware.read();
+    }
+
+    inline Section::~Section()
+    {
+        std::ostringstream out;
+
+        print(out);
+        std::cerr << out.str() << std::flush;
+    }
+
+    inline void Section::print(std::ostream &out) const
+    {
+        const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+        const Snapshot diff = (wholeRun ? snapshot() : threadSnapshot()) - start;
+        std::array<std::uint64_t, numOfHardware> hw = hardware.read();
+        size_t i;
+
+        for (i = 0; i < numOfHardware; ++i)
+        {
+            hw[i] -= hardwareStart[i];
+        }
+
+        out << std::setprecision(4);
+        if (!wholeRun)
+        {
+            out << "[instrument] " << label << ": " << seconds << " s";
+            for (i = 0; i < numOfCounters; ++i)
+            {
+                if (diff.counts[i] != 0)
+                    out << ", " << counterNames[i] << " " << diff.counts[i];
+            }
+            for (i = 0; i < numOfPhases; ++i)
+            {
+                if (diff.phaseCalls[i] != 0)
+                    out << ", " << phaseNames[i] << " " << diff.phaseNanoseconds[i] * 1e-9 << " s";
+            }
+            if (hardware.available())
+            {
+                for (i = 0; i < numOfHardware; ++i)
+                {
+                    out << ", " << hardwareNames[i] << " " << hw[i];
+                }
+            }
+            out << std::endl;
+            return;
+        }
+
+        out << "[instrument] " << label << ": " << seconds << " s (wall)" << std::endl;
+        for (i = 0; i < numOfCounters; ++i)
+        {
+            out << "  " << std::left << std::setw(24) << counterNames[i] << std::right << std::setw(16) << diff.counts[i];
+            if (i == IC_MAP && diff.counts[IC_MAP] != 0)
+                out << "  (" << seconds * 1e9 / diff.counts[IC_MAP] << " ns of wall time per evaluation)";
+            out << std::endl;
+        }
+        for (i = 0; i < numOfPhases; ++i)
+        {
+            if (diff.phaseCalls[i] == 0)
+                continue;
+            out << "  " << std::left << std::setw(24) << ("phase " + string(phaseNames[i])) << std::right << std::setw(14) << diff.phaseNanoseconds[i] * 1e-9
+                << " s  (" << diff.phaseCalls[i] << " calls, summed over the threads)" << std::endl;
+        }
+        for (i = 0; i < numOfHardware; ++i)
+        {
+            out << "  " << std::left << std::setw(24) << hardwareNames[i] << std::right << std::setw(16);
+            if (hardware.available())
+                out << hw[i];
+            else
+                out << "n/a";
+            out << std::endl;
+        }
+        if (hardware.available() && hw[IH_CYCLES] != 0)
+            out << "  " << std::left << std::setw(24) << "instructions per cycle" << std::right << std::setw(16) << (double)hw[IH_INSTRUCTIONS] / hw[IH_CYCLES] << std::endl;
+    }
+}
+
+#define GAUSSSIM_INSTRUMENT_CONCAT_(a, b) a##b
+#define GAUSSSIM_INSTRUMENT_CONCAT(a, b) GAUSSSIM_INSTRUMENT_CONCAT_(a, b)
+
+#define GAUSSSIM_COUNT(counter, k) ::GaussSim::instrument::count(::GaussSim::instrument::counter, (k))
+#define GAUSSSIM_PHASE(phase) \
+    ::GaussSim::instrument::PhaseScope GAUSSSIM_INSTRUMENT_CONCAT(gaussSimPhase, __LINE__)(::GaussSim::instrument::phase)
+#define GAUSSSIM_INSTRUMENT_EXPERIMENT(label) \
+    ::GaussSim::instrument::Section GAUSSSIM_INSTRUMENT_CONCAT(gaussSimSection, __LINE__)((label), false)
+#define GAUSSSIM_INSTRUMENT_RUN(label) \
+    ::GaussSim::instrument::Section GAUSSSIM_INSTRUMENT_CONCAT(gaussSimSection, __LINE__)((label), true)
+
+#else
+
+#define GAUSSSIM_COUNT(counter, k) ((void)0)
+#define GAUSSSIM_PHASE(phase) ((void)0)
+#define GAUSSSIM_INSTRUMENT_EXPERIMENT(label) ((void)0)
+#define GAUSSSIM_INSTRUMENT_RUN(label) ((void)0)
+
+#endif
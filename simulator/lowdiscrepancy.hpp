@@ -0,0 +1,77 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+
+namespace GaussSim
+{
+    using std::array;
+
+    // halton sequence in [0, 1)^n
+    // the i-th coordinate is the radical inverse of the index in the i-th prime base
+    template <size_t n>
+    class HaltonSequence
+    {
+    protected:
+        array<size_t, n> bases;
+
+    public:
+        HaltonSequence();
+
+        // the index-th point (index = 0, 1, 2, ...; the origin is skipped)
+        array<double, n> point(size_t index) const;
+
+        static double radicalInverse(size_t index, size_t base);
+    };
+
+    template <size_t n>
+    HaltonSequence<n>::HaltonSequence()
+    {
+        size_t found = 0, candidate, d;
+        bool prime;
+
+        for (candidate = 2; found < n; ++candidate)
+        {
+            prime = true;
+            for (d = 2; d * d <= candidate; ++d)
+            {
+                if (candidate % d == 0)
+                {
+                    prime = false;
+                    break;
+                }
+            }
+            if (prime)
+                bases[found++] = candidate;
+        }
+    }
+
+    template <size_t n>
+    array<double, n> HaltonSequence<n>::point(size_t index) const
+    {
+        array<double, n> res;
+        size_t i;
+        for (i = 0; i < n; ++i)
+        {
+            res[i] = radicalInverse(index + 1, bases[i]);
+        }
+
+        return res;
+    }
+
+    template <size_t n>
+    double HaltonSequence<n>::radicalInverse(size_t index, size_t base)
+    {
+        const double inverse = 1.0 / base;
+        double digitWeight = inverse, res = 0;
+
+        while (index > 0)
+        {
+            res += (index % base) * digitWeight;
+            index /= base;
+            digitWeight *= inverse;
+        }
+
+        return res;
+    }
+}
@@ -2,72 +2,208 @@
 
 #include "real.hpp"
 #include <algorithm>
+#include <concepts>
+#include <stdexcept>
+#include <utility>
+#include <vector>
 
 namespace GaussSim
 {
     // n x m matrix (n: num of rows, m: num of columns)
+    // the sizes are known at compile time, so the kernels below are written as fold expressions over index sequences
+    // and are fully unrolled; all operations are constexpr
     template <RealSubgroup G, size_t n, size_t m>
     struct Matrix
     {
         array<array<G, m>, n> entries; // entries[i][j] = the entry at i-th row and j-th column
 
+        // construction
+
+        static constexpr Matrix<G, n, m> zero();
+        static constexpr Matrix<G, n, m> identity() requires(n == m);
+
         // multiplication
 
-        array<G, n> operator*(array<G, m>) const;
+        constexpr array<G, n> operator*(array<G, m>) const;
 
         template <size_t k>
-        const Matrix<G, n, k> operator*(const Matrix<G, m, k> &) const;
+        constexpr const Matrix<G, n, k> operator*(const Matrix<G, m, k> &) const;
+
+        // out = this * in for many vectors at once
+        // the vectors are given in structure-of-arrays layout (in[j][p] = the j-th entry of the p-th vector, like TorusBatch),
+        // so that the loop over the vectors is vectorized
+        void multiplyBatch(const array<std::vector<G>, m> &in, array<std::vector<G>, n> &out) const;
+
+        // linear operations
+
+        constexpr const Matrix<G, n, m> operator+(const Matrix<G, n, m> &) const;
+        constexpr const Matrix<G, n, m> operator-(const Matrix<G, n, m> &) const;
+        constexpr const Matrix<G, n, m> operator*(G) const;
+        constexpr bool operator==(const Matrix<G, n, m> &) const = default;
 
         // operation
 
-        const Matrix<G, m, n> transpose() const;
+        constexpr const Matrix<G, m, n> transpose() const;
+
+        // square matrices
+
+        // the determinant (fraction-free elimination for integers, partial pivoting otherwise)
+        constexpr G determinant() const requires(n == m);
+        // the inverse matrix (throws std::domain_error if singular, or if an integer matrix is not unimodular)
+        constexpr const Matrix<G, n, m> inverse() const requires(n == m);
+        // the k-th power (k < 0: the power of the inverse) by repeated squaring
+        constexpr const Matrix<G, n, m> power(long long k) const requires(n == m);
+
+    protected:
+        // the matrix without the row r and the column c
+        constexpr Matrix<G, n - 1, m - 1> minor(size_t r, size_t c) const requires(n == m && n > 1);
+
+        template <size_t... J>
+        static constexpr G dot(const array<G, m> &row, const array<G, m> &vec, std::index_sequence<J...>);
+        template <size_t... I>
+        constexpr array<G, n> multiplyVector(const array<G, m> &vec, std::index_sequence<I...>) const;
     };
 
     template <RealSubgroup G, size_t n, size_t m>
-    array<G, n> Matrix<G, n, m>::operator*(array<G, m> vec) const
+    constexpr Matrix<G, n, m> Matrix<G, n, m>::zero()
     {
-        int i, j;
-        array<G, n> ans;
+        Matrix<G, n, m> mat;
+        size_t i;
+        for (i = 0; i < n; ++i)
+        {
+            mat.entries[i].fill(static_cast<G>(0));
+        }
+
+        return mat;
+    }
 
+    template <RealSubgroup G, size_t n, size_t m>
+    constexpr Matrix<G, n, m> Matrix<G, n, m>::identity() requires(n == m)
+    {
+        Matrix<G, n, m> mat = zero();
+        size_t i;
         for (i = 0; i < n; ++i)
         {
-            ans[i] = static_cast<G>(0);
-            for (j = 0; j < m; ++j)
-            {
-                ans[i] += entries[i][j] * vec[j];
-            }
+            mat.entries[i][i] = static_cast<G>(1);
         }
 
-        return ans;
+        return mat;
+    }
+
+    template <RealSubgroup G, size_t n, size_t m>
+    template <size_t... J>
+    constexpr G Matrix<G, n, m>::dot(const array<G, m> &row, const array<G, m> &vec, std::index_sequence<J...>)
+    {
+        return (static_cast<G>(0) + ... + (row[J] * vec[J]));
+    }
+
+    template <RealSubgroup G, size_t n, size_t m>
+    template <size_t... I>
+    constexpr array<G, n> Matrix<G, n, m>::multiplyVector(const array<G, m> &vec, std::index_sequence<I...>) const
+    {
+        return array<G, n>{dot(entries[I], vec, std::make_index_sequence<m>{})...};
+    }
+
+    template <RealSubgroup G, size_t n, size_t m>
+    constexpr array<G, n> Matrix<G, n, m>::operator*(array<G, m> vec) const
+    {
+        return multiplyVector(vec, std::make_index_sequence<n>{});
     }
 
     template <RealSubgroup G, size_t n, size_t m>
     template <size_t k>
-    const Matrix<G, n, k> Matrix<G, n, m>::operator*(const Matrix<G, m, k> &mat) const
+    constexpr const Matrix<G, n, k> Matrix<G, n, m>::operator*(const Matrix<G, m, k> &mat) const
     {
         Matrix<G, n, k> ans;
-        int a, b, c;
+        const Matrix<G, k, m> transposed = mat.transpose();
+        size_t a, b;
         for (a = 0; a < n; ++a)
         {
             for (b = 0; b < k; ++b)
             {
-                ans[a][b] = static_cast<G>(0);
-                for (c = 0; c < m; ++c)
+                ans.entries[a][b] = dot(entries[a], transposed.entries[b], std::make_index_sequence<m>{});
+            }
+        }
+
+        return ans;
+    }
+
+    template <RealSubgroup G, size_t n, size_t m>
+    void Matrix<G, n, m>::multiplyBatch(const array<std::vector<G>, m> &in, array<std::vector<G>, n> &out) const
+    {
+        const size_t size = in[0].size();
+        size_t i, j, p;
+
+        for (i = 0; i < n; ++i)
+        {
+            out[i].assign(size, static_cast<G>(0));
+            G *dst = out[i].data();
+            for (j = 0; j < m; ++j)
+            {
+                const G *src = in[j].data();
+                const G coefficient = entries[i][j];
+                for (p = 0; p < size; ++p)
                 {
-                    ans[a][b] += entries[a][c] * mat.entries[c][b];
+                    dst[p] += coefficient * src[p];
                 }
             }
         }
+    }
+
+    template <RealSubgroup G, size_t n, size_t m>
+    constexpr const Matrix<G, n, m> Matrix<G, n, m>::operator+(const Matrix<G, n, m> &mat) const
+    {
+        Matrix<G, n, m> ans;
+        size_t i, j;
+        for (i = 0; i < n; ++i)
+        {
+            for (j = 0; j < m; ++j)
+            {
+                ans.entries[i][j] = entries[i][j] + mat.entries[i][j];
+            }
+        }
+
+        return ans;
+    }
+
+    template <RealSubgroup G, size_t n, size_t m>
+    constexpr const Matrix<G, n, m> Matrix<G, n, m>::operator-(const Matrix<G, n, m> &mat) const
+    {
+        Matrix<G, n, m> ans;
+        size_t i, j;
+        for (i = 0; i < n; ++i)
+        {
+            for (j = 0; j < m; ++j)
+            {
+                ans.entries[i][j] = entries[i][j] - mat.entries[i][j];
+            }
+        }
 
         return ans;
     }
 
     template <RealSubgroup G, size_t n, size_t m>
-    const Matrix<G, m, n> Matrix<G, n, m>::transpose() const
+    constexpr const Matrix<G, n, m> Matrix<G, n, m>::operator*(G scalar) const
+    {
+        Matrix<G, n, m> ans;
+        size_t i, j;
+        for (i = 0; i < n; ++i)
+        {
+            for (j = 0; j < m; ++j)
+            {
+                ans.entries[i][j] = entries[i][j] * scalar;
+            }
+        }
+
+        return ans;
+    }
+
+    template <RealSubgroup G, size_t n, size_t m>
+    constexpr const Matrix<G, m, n> Matrix<G, n, m>::transpose() const
     {
         Matrix<G, m, n> res;
 
-        int i, j;
+        size_t i, j;
         for (i = 0; i < n; ++i)
         {
             for (j = 0; j < m; ++j)
@@ -79,6 +215,202 @@ namespace GaussSim
         return res;
     }
 
+    template <RealSubgroup G, size_t n, size_t m>
+    constexpr Matrix<G, n - 1, m - 1> Matrix<G, n, m>::minor(size_t r, size_t c) const requires(n == m && n > 1)
+    {
+        Matrix<G, n - 1, m - 1> res;
+        size_t i, j;
+        for (i = 0; i < n - 1; ++i)
+        {
+            for (j = 0; j < m - 1; ++j)
+            {
+                res.entries[i][j] = entries[i < r ? i : i + 1][j < c ? j : j + 1];
+            }
+        }
+
+        return res;
+    }
+
+    template <RealSubgroup G, size_t n, size_t m>
+    constexpr G Matrix<G, n, m>::determinant() const requires(n == m)
+    {
+        if constexpr (n == 1)
+        {
+            return entries[0][0];
+        }
+        else if constexpr (n == 2)
+        {
+            return entries[0][0] * entries[1][1] - entries[0][1] * entries[1][0];
+        }
+        else if constexpr (n == 3)
+        {
+            return entries[0][0] * (entries[1][1] * entries[2][2] - entries[1][2] * entries[2][1]) -
+                   entries[0][1] * (entries[1][0] * entries[2][2] - entries[1][2] * entries[2][0]) +
+                   entries[0][2] * (entries[1][0] * entries[2][1] - entries[1][1] * entries[2][0]);
+        }
+        else if constexpr (std::integral<G>)
+        {
+            // bareiss algorithm: every division is exact
+            array<array<G, m>, n> a = entries;
+            G previous = static_cast<G>(1), sign = static_cast<G>(1);
+            size_t i, j, k;
+            for (k = 0; k < n - 1; ++k)
+            {
+                if (a[k][k] == 0)
+                {
+                    for (i = k + 1; i < n && a[i][k] == 0; ++i)
+                        ;
+                    if (i == n)
+                        return static_cast<G>(0);
+                    std::swap(a[k], a[i]);
+                    sign = -sign;
+                }
+                for (i = k + 1; i < n; ++i)
+                {
+                    for (j = k + 1; j < n; ++j)
+                    {
+                        a[i][j] = (a[i][j] * a[k][k] - a[i][k] * a[k][j]) / previous;
+                    }
+                }
+                previous = a[k][k];
+            }
+
+            return sign * a[n - 1][n - 1];
+        }
+        else
+        {
+            // gaussian elimination with partial pivoting
+            array<array<G, m>, n> a = entries;
+            G det = static_cast<G>(1), factor;
+            size_t i, j, k, pivot;
+            auto absolute = [](G x)
+            { return (x < 0) ? -x : x; };
+
+            for (k = 0; k < n; ++k)
+            {
+                pivot = k;
+                for (i = k + 1; i < n; ++i)
+                {
+                    if (absolute(a[i][k]) > absolute(a[pivot][k]))
+                        pivot = i;
+                }
+                if (a[pivot][k] == static_cast<G>(0))
+                    return static_cast<G>(0);
+                if (pivot != k)
+                {
+                    std::swap(a[k], a[pivot]);
+                    det = -det;
+                }
+                det = det * a[k][k];
+                for (i = k + 1; i < n; ++i)
+                {
+                    factor = a[i][k] / a[k][k];
+                    for (j = k; j < n; ++j)
+                    {
+                        a[i][j] = a[i][j] - factor * a[k][j];
+                    }
+                }
+            }
+
+            return det;
+        }
+    }
+
+    template <RealSubgroup G, size_t n, size_t m>
+    constexpr const Matrix<G, n, m> Matrix<G, n, m>::inverse() const requires(n == m)
+    {
+        if constexpr (std::integral<G>)
+        {
+            // adjugate / determinant, exact if and only if the matrix is unimodular
+            const G det = determinant();
+            Matrix<G, n, m> res;
+            size_t i, j;
+
+            if (det != 1 && det != -1)
+                throw std::domain_error("Matrix::inverse: the integer matrix is not unimodular");
+
+            if constexpr (n == 1)
+            {
+                res.entries[0][0] = det;
+            }
+            else
+            {
+                for (i = 0; i < n; ++i)
+                {
+                    for (j = 0; j < n; ++j)
+                    {
+                        // the (j, i) cofactor
+                        res.entries[i][j] = minor(j, i).determinant() * (((i + j) % 2 == 0) ? 1 : -1) * det;
+                    }
+                }
+            }
+
+            return res;
+        }
+        else
+        {
+            // gauss-jordan elimination with partial pivoting
+            array<array<G, m>, n> a = entries;
+            Matrix<G, n, m> res = identity();
+            G factor;
+            size_t i, j, k, pivot;
+            auto absolute = [](G x)
+            { return (x < 0) ? -x : x; };
+
+            for (k = 0; k < n; ++k)
+            {
+                pivot = k;
+                for (i = k + 1; i < n; ++i)
+                {
+                    if (absolute(a[i][k]) > absolute(a[pivot][k]))
+                        pivot = i;
+                }
+                if (a[pivot][k] == static_cast<G>(0))
+                    throw std::domain_error("Matrix::inverse: the matrix is singular");
+                std::swap(a[k], a[pivot]);
+                std::swap(res.entries[k], res.entries[pivot]);
+
+                factor = a[k][k];
+                for (j = 0; j < n; ++j)
+                {
+                    a[k][j] = a[k][j] / factor;
+                    res.entries[k][j] = res.entries[k][j] / factor;
+                }
+                for (i = 0; i < n; ++i)
+                {
+                    if (i == k)
+                        continue;
+                    factor = a[i][k];
+                    for (j = 0; j < n; ++j)
+                    {
+                        a[i][j] = a[i][j] - factor * a[k][j];
+                        res.entries[i][j] = res.entries[i][j] - factor * res.entries[k][j];
+                    }
+                }
+            }
+
+            return res;
+        }
+    }
+
+    template <RealSubgroup G, size_t n, size_t m>
+    constexpr const Matrix<G, n, m> Matrix<G, n, m>::power(long long k) const requires(n == m)
+    {
+        Matrix<G, n, m> base = (k < 0) ? inverse() : *this;
+        Matrix<G, n, m> res = identity();
+        unsigned long long e = (k < 0) ? -static_cast<unsigned long long>(k) : static_cast<unsigned long long>(k);
+
+        while (e > 0)
+        {
+            if (e & 1)
+                res = res * base;
+            base = base * base;
+            e >>= 1;
+        }
+
+        return res;
+    }
+
     template <RealSubgroup G, size_t n>
     struct SquareMatrix : public Matrix<G, n, n>
     {
@@ -93,4 +425,4 @@ namespace GaussSim
 
         return mat;
     }
-}
\ No newline at end of file
+}
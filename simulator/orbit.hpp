@@ -0,0 +1,74 @@
+#pragma once
+
+#include "torus.hpp"
+
+#include <iterator>
+#include <ranges>
+
+namespace GaussSim
+{
+    // a range of points on the torus, e.g. vector<Torus<R, n>> or OrbitView
+    template <typename Range, typename R, size_t n>
+    concept OrbitRange =
+        std::ranges::input_range<Range> &&
+        std::convertible_to<std::ranges::range_value_t<Range>, Torus<R, n>>;
+
+    // lazy orbit {x, T(x), T^2(x), ..., T^{N-1}(x)} of the transformation T of type G
+    // each point is computed when the iterator is advanced, so the orbit is never stored
+    // (the transformation must outlive the view)
+    template <Real R, size_t n, typename G>
+    class OrbitView : public std::ranges::view_interface<OrbitView<R, n, G>>
+    {
+    protected:
+        const G *transformation = nullptr;
+        Torus<R, n> initial;
+        size_t numOfIteration = 0;
+
+    public:
+        class Iterator
+        {
+        protected:
+            const G *transformation = nullptr;
+            Torus<R, n> point;
+            size_t index = 0;
+
+        public:
+            using iterator_concept = std::forward_iterator_tag;
+            using iterator_category = std::input_iterator_tag;
+            using value_type = Torus<R, n>;
+            using difference_type = std::ptrdiff_t;
+
+            Iterator() {}
+            Iterator(const G *transformation, Torus<R, n> point, size_t index)
+                : transformation(transformation), point(point), index(index) {}
+
+            const Torus<R, n> &operator*() const { return point; }
+            // the number of times T has been applied
+            size_t step() const { return index; }
+
+            Iterator &operator++()
+            {
+                point = (*transformation)(point);
+                ++index;
+                return *this;
+            }
+            Iterator operator++(int)
+            {
+                Iterator res = *this;
+                ++*this;
+                return res;
+            }
+
+            bool operator==(const Iterator &itr) const { return index == itr.index; }
+        };
+
+        OrbitView() {}
+        OrbitView(const G &transformation, Torus<R, n> initial, size_t numOfIteration)
+            : transformation(&transformation), initial(initial, false), numOfIteration(numOfIteration) {}
+
+        Iterator begin() const { return Iterator(transformation, initial, 0); }
+        // the end iterator only carries the index, it is never dereferenced
+        Iterator end() const { return Iterator(transformation, initial, numOfIteration); }
+        size_t size() const { return numOfIteration; }
+    };
+}
@@ -0,0 +1,590 @@
+#pragma once
+
+#include "gauss.hpp"
+#include "doubledouble.hpp"
+#include "fixedpoint.hpp"
+#include "util.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <ranges>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#if __has_include(<sys/mman.h>)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define GAUSSSIM_HAS_MMAP 1
+#endif
+
+namespace GaussSim
+{
+    using std::string;
+    using std::vector;
+
+    // on-disk orbit format (native byte order, little endian):
+    //   OrbitFileHeader, the map parameters (text),
+    //   coordinates at coordinateOffset: lane 0 (capacity values), lane 1, ..., lane n-1 (structure of arrays),
+    //   digits at digitOffset (if any): the same layout with NaturalNumber values
+    // the offsets are aligned to pages, and the coordinates are the payload of a C-order .npy array of shape (n, capacity)
+    // (e.g. numpy.memmap(path, dtype=descr, offset=coordinateOffset, shape=(n, capacity)))
+    struct OrbitFileHeader
+    {
+        char magic[8];              // "GSORBIT1"
+        std::uint64_t dimension;    // n
+        std::uint64_t elementSize;  // sizeof(R)
+        char descr[48];             // numpy dtype of a coordinate
+        std::uint64_t capacity;     // the number of points the file has room for
+        std::uint64_t count;        // the number of points written
+        std::uint64_t hasDigits;    // 1 if the digits are stored
+        std::uint64_t parametersLength;
+        std::uint64_t coordinateOffset;
+        std::uint64_t digitOffset;  // 0 if the digits are not stored
+    };
+
+    const char orbitFileMagic[8] = {'G', 'S', 'O', 'R', 'B', 'I', 'T', '1'};
+    const std::uint64_t orbitFileAlignment = 4096;
+
+    // the numpy dtype of the coordinates of type R
+    template <typename R>
+    struct OrbitElement;
+    template <>
+    struct OrbitElement<double>
+    {
+        static constexpr const char *descr = "<f8";
+    };
+    template <>
+    struct OrbitElement<FixedPoint64>
+    {
+        static constexpr const char *descr = "<u8";
+    };
+    template <>
+    struct OrbitElement<DoubleDouble>
+    {
+        static constexpr const char *descr = "[('hi', '<f8'), ('lo', '<f8')]";
+    };
+
+    template <typename R>
+    concept StorableReal =
+        Real<R> && std::is_trivially_copyable_v<R> &&
+        requires { OrbitElement<R>::descr; };
+
+    namespace detail
+    {
+        inline std::uint64_t alignOffset(std::uint64_t offset)
+        {
+            return (offset + orbitFileAlignment - 1) / orbitFileAlignment * orbitFileAlignment;
+        }
+
+        // write the header of a .npy file (version 1.0) of a C-order array
+        inline void writeNpyHeader(std::ostream &out, const string &descr, const string &shape)
+        {
+            string dict = "{'descr': " + (descr[0] == '[' ? descr : "'" + descr + "'") + ", 'fortran_order': False, 'shape': " + shape + ", }";
+            // magic (6) + version (2) + length (2) + dict + '\n' is a multiple of 64
+            dict.append(63 - (10 + dict.size()) % 64, ' ');
+            dict.push_back('\n');
+
+            const std::uint16_t length = dict.size();
+            out.write("\x93NUMPY\x01\x00", 8);
+            out.write(reinterpret_cast<const char *>(&length), sizeof(length));
+            out.write(dict.data(), dict.size());
+        }
+    }
+
+    // read-only view of a whole file (mmap where available, otherwise read into memory)
+    class MappedFile
+    {
+    protected:
+        const char *data = nullptr;
+        size_t length = 0;
+#ifdef GAUSSSIM_HAS_MMAP
+        void *mapping = nullptr;
+#else
+        vector<char> buffer;
+#endif
+
+    public:
+        MappedFile(const string &path);
+        MappedFile(const MappedFile &) = delete;
+        MappedFile &operator=(const MappedFile &) = delete;
+        ~MappedFile();
+
+        const char *getData() const { return data; }
+        size_t size() const { return length; }
+    };
+
+    inline MappedFile::MappedFile(const string &path)
+    {
+#ifdef GAUSSSIM_HAS_MMAP
+        struct stat status;
+        int fd = ::open(path.c_str(), O_RDONLY);
+
+        if (fd < 0)
+            throw std::runtime_error("orbit store: cannot open " + path);
+        if (::fstat(fd, &status) != 0)
+        {
+            ::close(fd);
+            throw std::runtime_error("orbit store: cannot stat " + path);
+        }
+        length = status.st_size;
+        if (length > 0)
+        {
+            mapping = ::mmap(nullptr, length, PROT_READ, MAP_SHARED, fd, 0);
+            if (mapping == MAP_FAILED)
+            {
+                ::close(fd);
+                throw std::runtime_error("orbit store: cannot map " + path);
+            }
+            // the orbit is read from the beginning to the end
+            ::madvise(mapping, length, MADV_SEQUENTIAL);
+            data = static_cast<const char *>(mapping);
+        }
+        // the mapping stays valid after the descriptor is closed
+        ::close(fd);
+#else
+        std::ifstream in(path, std::ios::binary);
+        if (!in)
+            throw std::runtime_error("orbit store: cannot open " + path);
+        buffer.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+        data = buffer.data();
+        length = buffer.size();
+#endif
+    }
+
+    inline MappedFile::~MappedFile()
+    {
+#ifdef GAUSSSIM_HAS_MMAP
+        if (mapping != nullptr)
+            ::munmap(mapping, length);
+#endif
+    }
+
+    // streams the points of an orbit (and optionally their digits) to an orbit file
+    // the points are buffered per coordinate and written lane by lane, so memory use does not depend on the length
+    template <StorableReal R, size_t n>
+    class OrbitWriter
+    {
+    protected:
+        std::ofstream out;
+        OrbitFileHeader header;
+        array<vector<R>, n> buffer;
+        array<vector<NaturalNumber>, n> digitBuffer;
+        size_t numOfFlushed = 0;
+
+        void flush();
+        // digits = nullptr: the digits (if stored) are 0
+        void append(const Torus<R, n> &point, const array<NaturalNumber, n> *digits);
+
+    public:
+        static const size_t bufferSize = 1 << 16;
+
+        // throws std::runtime_error if the file cannot be written
+        OrbitWriter(const string &path, size_t capacity, const string &parameters = "", bool withDigits = false);
+        OrbitWriter(const OrbitWriter &) = delete;
+        OrbitWriter &operator=(const OrbitWriter &) = delete;
+        ~OrbitWriter();
+
+        // append a point (throws std::length_error if the file is full)
+        void push(const Torus<R, n> &point);
+        void push(const Torus<R, n> &point, const array<NaturalNumber, n> &digits);
+
+        size_t size() const { return numOfFlushed + buffer[0].size(); }
+
+        // write the remaining points and the final header
+        void close();
+    };
+
+    template <StorableReal R, size_t n>
+    OrbitWriter<R, n>::OrbitWriter(const string &path, size_t capacity, const string &parameters, bool withDigits)
+        : out(path, std::ios::binary | std::ios::trunc)
+    {
+        static_assert(std::endian::native == std::endian::little, "the orbit format is little endian");
+
+        if (!out)
+            throw std::runtime_error("orbit store: cannot open " + path);
+
+        std::memset(&header, 0, sizeof(header));
+        std::memcpy(header.magic, orbitFileMagic, sizeof(orbitFileMagic));
+        std::strncpy(header.descr, OrbitElement<R>::descr, sizeof(header.descr) - 1);
+        header.dimension = n;
+        header.elementSize = sizeof(R);
+        header.capacity = capacity;
+        header.hasDigits = withDigits ? 1 : 0;
+        header.parametersLength = parameters.size();
+        header.coordinateOffset = detail::alignOffset(sizeof(header) + parameters.size());
+        header.digitOffset = withDigits ? detail::alignOffset(header.coordinateOffset + n * capacity * sizeof(R)) : 0;
+
+        out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+        out.write(parameters.data(), parameters.size());
+
+        size_t i;
+        for (i = 0; i < n; ++i)
+        {
+            buffer[i].reserve(bufferSize);
+            if (withDigits)
+                digitBuffer[i].reserve(bufferSize);
+        }
+    }
+
+    template <StorableReal R, size_t n>
+    OrbitWriter<R, n>::~OrbitWriter()
+    {
+        if (!out.is_open())
+            return;
+        try
+        {
+            close();
+        }
+        catch (...)
+        {
+        }
+    }
+
+    template <StorableReal R, size_t n>
+    void OrbitWriter<R, n>::push(const Torus<R, n> &point)
+    {
+        append(point, nullptr);
+    }
+
+    template <StorableReal R, size_t n>
+    void OrbitWriter<R, n>::push(const Torus<R, n> &point, const array<NaturalNumber, n> &digits)
+    {
+        append(point, &digits);
+    }
+
+    template <StorableReal R, size_t n>
+    void OrbitWriter<R, n>::append(const Torus<R, n> &point, const array<NaturalNumber, n> *digits)
+    {
+        size_t i;
+
+        if (size() >= header.capacity)
+            throw std::length_error("orbit store: the file is full");
+
+        for (i = 0; i < n; ++i)
+        {
+            buffer[i].push_back(point.coordinate[i]);
+            if (header.hasDigits)
+                digitBuffer[i].push_back(digits ? (*digits)[i] : 0);
+        }
+        if (buffer[0].size() == bufferSize)
+            flush();
+    }
+
+    template <StorableReal R, size_t n>
+    void OrbitWriter<R, n>::flush()
+    {
+        size_t i;
+
+        for (i = 0; i < n; ++i)
+        {
+            out.seekp(header.coordinateOffset + (i * header.capacity + numOfFlushed) * sizeof(R));
+            out.write(reinterpret_cast<const char *>(buffer[i].data()), buffer[i].size() * sizeof(R));
+            if (header.hasDigits)
+            {
+                out.seekp(header.digitOffset + (i * header.capacity + numOfFlushed) * sizeof(NaturalNumber));
+                out.write(reinterpret_cast<const char *>(digitBuffer[i].data()), digitBuffer[i].size() * sizeof(NaturalNumber));
+                digitBuffer[i].clear();
+            }
+        }
+        numOfFlushed += buffer[0].size();
+        for (i = 0; i < n; ++i)
+        {
+            buffer[i].clear();
+        }
+
+        if (!out)
+            throw std::runtime_error("orbit store: write failed");
+    }
+
+    template <StorableReal R, size_t n>
+    void OrbitWriter<R, n>::close()
+    {
+        const std::uint64_t end = header.hasDigits ? header.digitOffset + n * header.capacity * sizeof(NaturalNumber)
+                                                   : header.coordinateOffset + n * header.capacity * sizeof(R);
+
+        flush();
+        header.count = numOfFlushed;
+        out.seekp(0);
+        out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+        // extend the file to its full layout, so that every lane can be mapped
+        // (only if it is shorter: the last byte is already data when the last lane is full)
+        out.seekp(0, std::ios::end);
+        if (static_cast<std::uint64_t>(out.tellp()) < end)
+        {
+            out.seekp(end - 1);
+            out.put('\0');
+        }
+        out.close();
+        if (!out)
+            throw std::runtime_error("orbit store: write failed");
+    }
+
+    // a stored orbit, read through a memory mapping (zero copy)
+    // points() is an OrbitRange, so it can be passed to StaticGGT::frequencyOfOrbit and densityHistogram
+    template <StorableReal R, size_t n>
+    class OrbitStore
+    {
+    protected:
+        MappedFile file;
+        OrbitFileHeader header;
+        string parameters;
+
+    public:
+        // throws std::runtime_error if the file is not an orbit of R on the n-dimensional torus
+        OrbitStore(const string &path);
+
+        size_t size() const { return header.count; }
+        const string &getParameters() const { return parameters; }
+        bool hasDigits() const { return header.hasDigits != 0; }
+
+        // the i-th coordinates of all points
+        const R *lane(size_t i) const { return reinterpret_cast<const R *>(file.getData() + header.coordinateOffset) + i * header.capacity; }
+        array<const R *, n> lanes() const;
+        // the i-th digits of all points (throws std::runtime_error if the digits are not stored)
+        const NaturalNumber *digitLane(size_t i) const;
+
+        // the k-th point / digits (digits() throws std::runtime_error if the digits are not stored)
+        Torus<R, n> operator[](size_t k) const;
+        array<NaturalNumber, n> digits(size_t k) const;
+
+        // all the points as a lazy range
+        auto points() const
+        {
+            return std::views::iota(size_t(0), size()) |
+                   std::views::transform([this](size_t k)
+                                         { return (*this)[k]; });
+        }
+
+        // the histogram of the stored orbit, binned directly from the mapped lanes
+        Histogram<n> densityHistogram(array<size_t, n> gridShape) const;
+
+        // the autocorrelation r(0), ..., r(maxLag) of the axis-th coordinate:
+        // r(l) = (mean of (x_k - m)(x_{k+l} - m) over k < N - l) / (variance), m: the mean
+        // (if the variance is 0, i.e. the coordinate is constant: r(0) = 1 and r(l) = 0 for l > 0)
+        // the lags are computed in parallel (with OpenMP)
+        vector<double> autocorrelation(size_t axis, size_t maxLag) const;
+
+        // write the coordinates / the digits as a .npy file of shape (n, size())
+        void exportNpy(const string &path) const;
+        void exportDigitsNpy(const string &path) const;
+    };
+
+    template <StorableReal R, size_t n>
+    OrbitStore<R, n>::OrbitStore(const string &path)
+        : file(path)
+    {
+        if (file.size() < sizeof(header))
+            throw std::runtime_error("orbit store: " + path + " is not an orbit file");
+
+        std::memcpy(&header, file.getData(), sizeof(header));
+        if (!std::equal(header.magic, header.magic + sizeof(header.magic), orbitFileMagic))
+            throw std::runtime_error("orbit store: " + path + " is not an orbit file");
+        if (std::memchr(header.descr, '\0', sizeof(header.descr)) == nullptr)
+            throw std::runtime_error("orbit store: " + path + " is corrupt (descr is not terminated)");
+        if (header.dimension != n || header.elementSize != sizeof(R) || string(header.descr) != OrbitElement<R>::descr)
+            throw std::runtime_error("orbit store: " + path + " is an orbit of another type (" + string(header.descr) + ", n = " + std::to_string(header.dimension) + ")");
+
+        // the header must describe a layout inside the file, so that the lanes are never read out of bounds
+        // (checked without overflow: the file is not trusted)
+        const std::uint64_t fileSize = file.size();
+        // whether n lanes of capacity values of elementSize bytes from offset lie in the file
+        auto lanesFit = [&](std::uint64_t offset, std::uint64_t elementSize)
+        {
+            return offset <= fileSize && header.capacity <= (fileSize - offset) / (n * elementSize);
+        };
+
+        if (header.parametersLength > fileSize - sizeof(header))
+            throw std::runtime_error("orbit store: " + path + " is truncated (parameters)");
+        if (header.count > header.capacity)
+            throw std::runtime_error("orbit store: " + path + " is corrupt (count > capacity)");
+        if (header.coordinateOffset < sizeof(header) + header.parametersLength || header.coordinateOffset % alignof(R) != 0)
+            throw std::runtime_error("orbit store: " + path + " is corrupt (coordinate offset)");
+        if (!lanesFit(header.coordinateOffset, sizeof(R)))
+            throw std::runtime_error("orbit store: " + path + " is truncated (coordinates)");
+        if (header.hasDigits > 1 || (header.hasDigits == 0 && header.digitOffset != 0))
+            throw std::runtime_error("orbit store: " + path + " is corrupt (digits)");
+        if (hasDigits())
+        {
+            if (header.digitOffset < header.coordinateOffset + n * header.capacity * sizeof(R) || header.digitOffset % alignof(NaturalNumber) != 0)
+                throw std::runtime_error("orbit store: " + path + " is corrupt (digit offset)");
+            if (!lanesFit(header.digitOffset, sizeof(NaturalNumber)))
+                throw std::runtime_error("orbit store: " + path + " is truncated (digits)");
+        }
+
+        parameters.assign(file.getData() + sizeof(header), header.parametersLength);
+    }
+
+    template <StorableReal R, size_t n>
+    const NaturalNumber *OrbitStore<R, n>::digitLane(size_t i) const
+    {
+        if (!hasDigits())
+            throw std::runtime_error("orbit store: the digits are not stored");
+
+        return reinterpret_cast<const NaturalNumber *>(file.getData() + header.digitOffset) + i * header.capacity;
+    }
+
+    template <StorableReal R, size_t n>
+    array<const R *, n> OrbitStore<R, n>::lanes() const
+    {
+        array<const R *, n> res;
+        size_t i;
+        for (i = 0; i < n; ++i)
+        {
+            res[i] = lane(i);
+        }
+
+        return res;
+    }
+
+    template <StorableReal R, size_t n>
+    Torus<R, n> OrbitStore<R, n>::operator[](size_t k) const
+    {
+        Torus<R, n> point;
+        size_t i;
+        for (i = 0; i < n; ++i)
+        {
+            point.coordinate[i] = lane(i)[k];
+        }
+
+        return point;
+    }
+
+    template <StorableReal R, size_t n>
+    array<NaturalNumber, n> OrbitStore<R, n>::digits(size_t k) const
+    {
+        array<NaturalNumber, n> res;
+        size_t i;
+        for (i = 0; i < n; ++i)
+        {
+            res[i] = digitLane(i)[k];
+        }
+
+        return res;
+    }
+
+    template <StorableReal R, size_t n>
+    Histogram<n> OrbitStore<R, n>::densityHistogram(array<size_t, n> gridShape) const
+    {
+        Histogram<n> hist(gridShape);
+
+        hist.template add<R>(lanes(), size());
+
+        return hist;
+    }
+
+    template <StorableReal R, size_t n>
+    vector<double> OrbitStore<R, n>::autocorrelation(size_t axis, size_t maxLag) const
+    {
+        const R *x = lane(axis);
+        const long long N = size();
+        const long long L = std::min<long long>(maxLag, N - 1);
+        vector<double> res(maxLag + 1, 0);
+        util::CompensatedSum<double> sum, squareSum;
+        double mean, variance;
+        long long k, l;
+
+        if (N == 0)
+            return res;
+
+        for (k = 0; k < N; ++k)
+        {
+            sum += static_cast<double>(x[k]);
+        }
+        mean = sum.value() / N;
+        for (k = 0; k < N; ++k)
+        {
+            squareSum += (static_cast<double>(x[k]) - mean) * (static_cast<double>(x[k]) - mean);
+        }
+        variance = squareSum.value() / N;
+
+        // a constant orbit (e.g. a fixed point) is perfectly correlated with itself only
+        if (variance == 0)
+        {
+            res[0] = 1;
+            return res;
+        }
+
+#pragma omp parallel for schedule(dynamic)
+        for (l = 0; l <= L; ++l)
+        {
+            util::CompensatedSum<double> covariance;
+            long long j;
+            for (j = 0; j + l < N; ++j)
+            {
+                covariance += (static_cast<double>(x[j]) - mean) * (static_cast<double>(x[j + l]) - mean);
+            }
+            res[l] = covariance.value() / (N - l) / variance;
+        }
+
+        return res;
+    }
+
+    template <StorableReal R, size_t n>
+    void OrbitStore<R, n>::exportNpy(const string &path) const
+    {
+        std::ofstream out(path, std::ios::binary | std::ios::trunc);
+        size_t i;
+
+        detail::writeNpyHeader(out, OrbitElement<R>::descr, "(" + std::to_string(n) + ", " + std::to_string(size()) + ")");
+        for (i = 0; i < n; ++i)
+        {
+            out.write(reinterpret_cast<const char *>(lane(i)), size() * sizeof(R));
+        }
+        if (!out)
+            throw std::runtime_error("orbit store: cannot write " + path);
+    }
+
+    template <StorableReal R, size_t n>
+    void OrbitStore<R, n>::exportDigitsNpy(const string &path) const
+    {
+        std::ofstream out(path, std::ios::binary | std::ios::trunc);
+        size_t i;
+
+        if (!hasDigits())
+            throw std::runtime_error("orbit store: the digits are not stored");
+
+        detail::writeNpyHeader(out, "<i8", "(" + std::to_string(n) + ", " + std::to_string(size()) + ")");
+        for (i = 0; i < n; ++i)
+        {
+            out.write(reinterpret_cast<const char *>(digitLane(i)), size() * sizeof(NaturalNumber));
+        }
+        if (!out)
+            throw std::runtime_error("orbit store: cannot write " + path);
+    }
+
+    // compute the orbit {x, T(x), ..., T^{N-1}(x)} of initial = x and stream it to path
+    // withDigits: also store the digits floor(T'(x)), floor(T'(T(x))), ... (the same as continuedFraction(x, N))
+    // (throws std::invalid_argument if R is reduced mod 1, e.g. FixedPoint64, which has no digits)
+    template <StorableReal R, size_t n, typename F>
+    void recordOrbit(const StaticGGT<R, n, F> &ggt, const string &path, Torus<R, n> initial, size_t numOfIteration,
+                     const string &parameters = "", bool withDigits = false)
+    {
+        if (withDigits && isReducedMod1<R>)
+            throw std::invalid_argument("orbit store: the digits of " + path + " cannot be computed in a type reduced mod 1");
+
+        OrbitWriter<R, n> writer(path, numOfIteration, parameters, withDigits);
+        Torus<R, n> point(initial, false);
+        array<R, n> image;
+        size_t i;
+
+        for (i = 0; i < numOfIteration; ++i)
+        {
+            image = ggt(point.coordinate);
+            if (withDigits)
+                writer.push(point, FloorArray<R, n>(image));
+            else
+                writer.push(point);
+            point = Torus<R, n>(image);
+        }
+
+        writer.close();
+    }
+}
@@ -0,0 +1,63 @@
+#pragma once
+
+#include "torus.hpp"
+#include "batch.hpp"
+
+#include <cstdint>
+#include <random>
+
+namespace GaussSim
+{
+    // splitmix64: advances state and returns the next well-mixed 64 bit value
+    inline std::uint64_t splitmix64(std::uint64_t &state)
+    {
+        std::uint64_t z = (state += 0x9e3779b97f4a7c15ULL);
+        z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+        z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+        return z ^ (z >> 31);
+    }
+
+    // the index-th random stream derived from seed
+    // streams with different (seed, index) are independent, and the stream depends only on (seed, index),
+    // so that the experiment with the index draws the same numbers in whatever order or thread it is run
+    inline std::mt19937_64 randomStream(std::uint64_t seed, std::uint64_t index)
+    {
+        std::uint64_t state = seed ^ splitmix64(index);
+        std::uint64_t a = splitmix64(state), b = splitmix64(state);
+        std::seed_seq seq{
+            static_cast<std::uint32_t>(a), static_cast<std::uint32_t>(a >> 32),
+            static_cast<std::uint32_t>(b), static_cast<std::uint32_t>(b >> 32)};
+
+        return std::mt19937_64(seq);
+    }
+
+    // a point uniformly distributed on the torus
+    template <Real R, size_t n, typename Engine>
+    Torus<R, n> randomTorus(Engine &engine)
+    {
+        std::uniform_real_distribution<double> rndm(0, 1);
+        Torus<R, n> x;
+        size_t i;
+        for (i = 0; i < n; ++i)
+        {
+            x.coordinate[i] = static_cast<R>(rndm(engine));
+        }
+
+        return x;
+    }
+
+    // the batch whose k-th point is drawn from randomStream(seed, first + k)
+    template <Real R, size_t n>
+    TorusBatch<R, n> randomBatch(std::uint64_t seed, std::uint64_t first, size_t size)
+    {
+        TorusBatch<R, n> batch(size);
+        size_t k;
+        for (k = 0; k < size; ++k)
+        {
+            auto engine = randomStream(seed, first + k);
+            batch.set(k, randomTorus<R, n>(engine));
+        }
+
+        return batch;
+    }
+}
@@ -5,24 +5,26 @@
 #include <array>
 #include <concepts>
 #include <cmath>
+#include <type_traits>
 
 namespace GaussSim
 {
 
-    int mod1(int a)
+    inline int mod1(int a)
     {
         return 0;
     }
-    double mod1(double a)
+    inline double mod1(double a)
     {
-        return std::fmod(a, 1.0);
+        // the same value as std::fmod(a, 1.0), but can be vectorized
+        return a - std::trunc(a);
     }
 
-    NaturalNumber floor(int a)
+    inline NaturalNumber floor(int a)
     {
         return a;
     }
-    NaturalNumber floor(double a)
+    inline NaturalNumber floor(double a)
     {
         return std::floor(a);
     }
@@ -94,6 +96,10 @@ namespace GaussSim
         { a / b } -> std::same_as<T>;
     };
 
+    // the built-in arithmetic types (for the mixed operators of number types defined as classes)
+    template <typename T>
+    concept BuiltinArithmetic = std::is_arithmetic_v<T>;
+
     template <typename R>
     concept RealSubgroup =
         std::convertible_to<R, double> &&
@@ -107,7 +113,14 @@ namespace GaussSim
         RealSubgroup<R> &&
         std::convertible_to<double, R>;
 
+    // true for the number types which represent only R/Z, i.e. whose values are all reduced mod 1 (e.g. FixedPoint64)
+    // the integers are 0 in them, so the lengths, the measures, the integrals and 1 / x cannot be computed in them
+    // (the functions which need them are not defined for these types)
+    template <typename R>
+    inline constexpr bool isReducedMod1 = false;
+
     template <RealSubgroup G, size_t n>
+        requires(!isReducedMod1<G>)
     array<G, n> INVERSE(array<G, n> arr)
     {
         array<G, n> res;
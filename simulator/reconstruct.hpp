@@ -35,6 +35,8 @@ namespace GaussSim
     template <Real R, size_t n>
     array<R, n> ReconstructGGT<R, n>::reconstruct(vector<array<NaturalNumber, n>> expansion) const
     {
+        GAUSSSIM_PHASE(IP_RECONSTRUCT);
+
         array<R, n> reconstructedValue;
         reconstructedValue.fill(static_cast<R>(0));
         for (auto ritr = expansion.rbegin(); ritr != expansion.rend(); ++ritr)
@@ -45,10 +47,209 @@ namespace GaussSim
         return reconstructedValue;
     }
 
+    // reconstruction for the transformations whose inverse branches are linear fractional
+    // the inverse branch of the digit d, x -> inverse(x + d), is given by the (n + 1) x (n + 1) matrix M_d on the homogeneous coordinates:
+    // inverse(x + d) = (y_0 / y_n, ..., y_{n-1} / y_n) where y = M_d (x_0, ..., x_{n-1}, 1)
+    // then the reconstruction from d_0, ..., d_{k-1} is given by the product M_{d_0} M_{d_1} ... M_{d_{k-1}} (0, ..., 0, 1),
+    // which is associative, so that it can be computed in parallel, and for all depths in a single pass
+    template <Real R, size_t n>
+    class MobiusReconstructGGT : public ReconstructGGT<R, n>
+    {
+    protected:
+        std::function<Matrix<R, n + 1, n + 1>(array<NaturalNumber, n>)> digitMatrix;
+
+        // divide the matrix by a power of 2 (exactly) so that the entries do not overflow
+        static void normalize(Matrix<R, n + 1, n + 1> &mat);
+        // (y_0 / y_n, ..., y_{n-1} / y_n) for the last column y of mat
+        static array<R, n> dehomogenize(const Matrix<R, n + 1, n + 1> &mat);
+
+    public:
+        MobiusReconstructGGT() {}
+        MobiusReconstructGGT(const ReconstructGGT<R, n> &rggt, std::function<Matrix<R, n + 1, n + 1>(array<NaturalNumber, n>)> digitMatrix)
+            : ReconstructGGT<R, n>(rggt), digitMatrix(digitMatrix) {}
+        MobiusReconstructGGT(
+            std::function<array<R, n>(array<R, n>)> originalTransformation,
+            std::function<array<R, n>(array<R, n>)> inverse,
+            std::function<Matrix<R, n + 1, n + 1>(array<NaturalNumber, n>)> digitMatrix)
+            : ReconstructGGT<R, n>(originalTransformation, inverse), digitMatrix(digitMatrix) {}
+
+        // the normalized product M_{d_0} M_{d_1} ... M_{d_{k-1}} (computed in parallel chunks with OpenMP)
+        Matrix<R, n + 1, n + 1> convergentMatrix(const vector<array<NaturalNumber, n>> &expansion) const;
+
+        array<R, n> reconstruct(Torus<R, n> value, size_t depthOfExpansion) const;
+        array<R, n> reconstruct(const vector<array<NaturalNumber, n>> &expansion) const;
+
+        // the reconstructions from the first 1, 2, ..., k digits (k = expansion.size()) in a single pass
+        vector<array<R, n>> reconstructAllDepths(const vector<array<NaturalNumber, n>> &expansion) const;
+        vector<array<R, n>> reconstructAllDepths(Torus<R, n> value, size_t depthOfExpansion) const;
+
+        // batch versions (in parallel with OpenMP)
+        vector<array<R, n>> reconstruct(const vector<vector<array<NaturalNumber, n>>> &expansions) const;
+        vector<array<R, n>> reconstruct(const TorusBatch<R, n> &values, size_t depthOfExpansion) const;
+    };
+
+    template <Real R, size_t n>
+    void MobiusReconstructGGT<R, n>::normalize(Matrix<R, n + 1, n + 1> &mat)
+    {
+        double maxAbs = 0, scale;
+        int exponent;
+        size_t i, j;
+
+        for (i = 0; i <= n; ++i)
+        {
+            for (j = 0; j <= n; ++j)
+            {
+                maxAbs = std::max(maxAbs, std::abs(static_cast<double>(mat.entries[i][j])));
+            }
+        }
+        if (maxAbs == 0 || !std::isfinite(maxAbs))
+            return;
+
+        std::frexp(maxAbs, &exponent);
+        scale = std::ldexp(1.0, -exponent);
+        for (i = 0; i <= n; ++i)
+        {
+            for (j = 0; j <= n; ++j)
+            {
+                mat.entries[i][j] = mat.entries[i][j] * scale;
+            }
+        }
+    }
+
+    template <Real R, size_t n>
+    array<R, n> MobiusReconstructGGT<R, n>::dehomogenize(const Matrix<R, n + 1, n + 1> &mat)
+    {
+        array<R, n> res;
+        size_t i;
+        for (i = 0; i < n; ++i)
+        {
+            // the same convention as INVERSE: 1 / 0 = 0
+            if (mat.entries[n][n] == static_cast<R>(0))
+                res[i] = static_cast<R>(0);
+            else
+                res[i] = mat.entries[i][n] / mat.entries[n][n];
+        }
+
+        return res;
+    }
+
+    template <Real R, size_t n>
+    Matrix<R, n + 1, n + 1> MobiusReconstructGGT<R, n>::convergentMatrix(const vector<array<NaturalNumber, n>> &expansion) const
+    {
+        const size_t chunkSize = 1024;
+        const size_t numOfChunks = (expansion.size() + chunkSize - 1) / chunkSize;
+        Matrix<R, n + 1, n + 1> product;
+        vector<Matrix<R, n + 1, n + 1>> chunkProducts(numOfChunks);
+        size_t c;
+
+#pragma omp parallel for schedule(static)
+        for (c = 0; c < numOfChunks; ++c)
+        {
+            size_t k, last = std::min((c + 1) * chunkSize, expansion.size());
+            Matrix<R, n + 1, n + 1> chunkProduct = Matrix<R, n + 1, n + 1>::identity();
+            for (k = c * chunkSize; k < last; ++k)
+            {
+                chunkProduct = chunkProduct * digitMatrix(expansion[k]);
+                normalize(chunkProduct);
+            }
+            chunkProducts[c] = chunkProduct;
+        }
+
+        // the product is associative but not commutative: combine the chunks in order
+        product = Matrix<R, n + 1, n + 1>::identity();
+        for (c = 0; c < numOfChunks; ++c)
+        {
+            product = product * chunkProducts[c];
+            normalize(product);
+        }
+
+        return product;
+    }
+
+    template <Real R, size_t n>
+    array<R, n> MobiusReconstructGGT<R, n>::reconstruct(Torus<R, n> value, size_t depthOfExpansion) const
+    {
+        return reconstruct(this->continuedFraction(value, depthOfExpansion));
+    }
+
+    template <Real R, size_t n>
+    array<R, n> MobiusReconstructGGT<R, n>::reconstruct(const vector<array<NaturalNumber, n>> &expansion) const
+    {
+        GAUSSSIM_PHASE(IP_RECONSTRUCT);
+
+        return dehomogenize(convergentMatrix(expansion));
+    }
+
+    template <Real R, size_t n>
+    vector<array<R, n>> MobiusReconstructGGT<R, n>::reconstructAllDepths(const vector<array<NaturalNumber, n>> &expansion) const
+    {
+        vector<array<R, n>> res;
+        Matrix<R, n + 1, n + 1> product = Matrix<R, n + 1, n + 1>::identity();
+
+        res.reserve(expansion.size());
+        for (auto itr = expansion.begin(); itr != expansion.end(); ++itr)
+        {
+            product = product * digitMatrix(*itr);
+            normalize(product);
+            res.push_back(dehomogenize(product));
+        }
+
+        return res;
+    }
+
+    template <Real R, size_t n>
+    vector<array<R, n>> MobiusReconstructGGT<R, n>::reconstructAllDepths(Torus<R, n> value, size_t depthOfExpansion) const
+    {
+        return reconstructAllDepths(this->continuedFraction(value, depthOfExpansion));
+    }
+
+    template <Real R, size_t n>
+    vector<array<R, n>> MobiusReconstructGGT<R, n>::reconstruct(const vector<vector<array<NaturalNumber, n>>> &expansions) const
+    {
+        GAUSSSIM_PHASE(IP_RECONSTRUCT);
+
+        vector<array<R, n>> res(expansions.size());
+        size_t k;
+
+#pragma omp parallel for schedule(dynamic, 64)
+        for (k = 0; k < expansions.size(); ++k)
+        {
+            Matrix<R, n + 1, n + 1> product = Matrix<R, n + 1, n + 1>::identity();
+            for (auto itr = expansions[k].begin(); itr != expansions[k].end(); ++itr)
+            {
+                product = product * digitMatrix(*itr);
+                normalize(product);
+            }
+            res[k] = dehomogenize(product);
+        }
+
+        return res;
+    }
+
+    template <Real R, size_t n>
+    vector<array<R, n>> MobiusReconstructGGT<R, n>::reconstruct(const TorusBatch<R, n> &values, size_t depthOfExpansion) const
+    {
+        return reconstruct(this->continuedFraction(values, depthOfExpansion));
+    }
+
     const ReconstructGGT<double, 1> reconstructNormalGT(
         normalGaussTransformation,
         [](array<double, 1> arr) -> array<double, 1>
         {
             return INVERSE<double, 1>(arr);
         });
+
+    const MobiusReconstructGGT<double, 1> mobiusReconstructNormalGT(
+        reconstructNormalGT,
+        [](array<NaturalNumber, 1> digit) -> Matrix<double, 2, 2>
+        {
+            // 1 / (x + d) = (0 x + 1) / (1 x + d)
+            // the digit 0 appears only after the orbit reaches 0 (INVERSE(0) = 0), so it keeps 0 as it is
+            Matrix<double, 2, 2> mat;
+            if (digit[0] == 0)
+                mat.entries = {{{1, 0}, {0, 1}}};
+            else
+                mat.entries = {{{0, 1}, {1, static_cast<double>(digit[0])}}};
+            return mat;
+        });
 }
\ No newline at end of file
@@ -0,0 +1,191 @@
+#pragma once
+
+#include "gauss.hpp"
+#include "densityresult.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <cstdint>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace GaussSim
+{
+    using std::string;
+    using std::vector;
+
+    // the index-th of count parts of a run of independent experiments
+    // the shard runs the experiments first(N), ..., last(N) - 1 of the N experiments of the run, and the k-th experiment
+    // draws from randomStream(seed, k) in every shard, so the shards together run exactly the experiments of the whole run
+    // and their merged result (DensityResult::operator+=, mergeFrequencies) is the result of the whole run
+    // shards only share the files they write, so they can run as separate processes or on separate machines
+    struct Shard
+    {
+        size_t index = 0;
+        size_t count = 1;
+
+        Shard() {}
+        // throws std::invalid_argument unless index < count
+        Shard(size_t index, size_t count);
+        // "index/count", e.g. "3/8"
+        static Shard parse(const string &text);
+
+        bool whole() const { return count == 1; }
+        size_t first(size_t numOfExperiments) const { return numOfExperiments * index / count; }
+        size_t last(size_t numOfExperiments) const { return numOfExperiments * (index + 1) / count; }
+
+        // "3of8" (for the names of the files of the shards)
+        string name() const { return std::to_string(index) + "of" + std::to_string(count); }
+    };
+
+    // the frequencies of the experiments first, first + 1, ... of a run of numOfExperiments experiments (frequencyOfRandomOrbits)
+    // (unlike counts, sums of frequencies depend on the order of the additions, so the frequencies themselves are kept)
+    struct FrequencyPartial
+    {
+        string parameters;
+        size_t numOfExperiments = 0;
+        size_t first = 0;
+        vector<double> frequencies;
+
+        bool complete() const { return first == 0 && frequencies.size() == numOfExperiments; }
+        // the mean frequency (of the whole run if complete())
+        double mean() const;
+
+        // binary file (little endian):
+        //   magic "GSFREQ01", parameters (length + bytes), numOfExperiments, first, the number of frequencies, frequencies (raw doubles)
+        // throws std::runtime_error if the file cannot be written / read, or is not a frequency partial
+        void save(const string &path) const;
+        static FrequencyPartial load(const string &path);
+    };
+
+    const char frequencyPartialMagic[8] = {'G', 'S', 'F', 'R', 'E', 'Q', '0', '1'};
+
+    // the frequencies of the experiments of the shard
+    template <Real R, size_t n, Transformation<R, n> F>
+    FrequencyPartial frequencyOfRandomOrbits(const StaticGGT<R, n, F> &ggt, Torus<R, n> rectBL, Torus<R, n> rectTR, size_t depth,
+                                             size_t numOfExperiments, std::uint64_t seed, Shard shard, const string &parameters);
+
+    // merge partials of the same run (given in any order) which together cover consecutive experiments into one partial
+    // the mean of the merged partial of all the shards is frequencyOfRandomOrbits of the whole run (bit-exactly)
+    // throws std::invalid_argument if the partials are of different runs, overlap, or leave a gap
+    FrequencyPartial mergeFrequencies(vector<FrequencyPartial> partials);
+
+    inline Shard::Shard(size_t index, size_t count)
+        : index(index), count(count)
+    {
+        if (index >= count)
+            throw std::invalid_argument("Shard: the index " + std::to_string(index) + " is not less than the number of shards " + std::to_string(count));
+    }
+
+    inline Shard Shard::parse(const string &text)
+    {
+        const size_t slash = text.find('/');
+
+        if (slash == string::npos)
+            throw std::invalid_argument("Shard: " + text + " is not of the form index/count");
+
+        return Shard(std::stoull(text.substr(0, slash)), std::stoull(text.substr(slash + 1)));
+    }
+
+    inline double FrequencyPartial::mean() const
+    {
+        double sumOfFrequency = 0;
+        size_t k;
+
+        // the same order as frequencyOfRandomOrbits
+        for (k = 0; k < frequencies.size(); ++k)
+        {
+            sumOfFrequency += frequencies[k];
+        }
+
+        return sumOfFrequency / frequencies.size();
+    }
+
+    inline void FrequencyPartial::save(const string &path) const
+    {
+        static_assert(std::endian::native == std::endian::little, "the frequency partial format is little endian");
+
+        std::ofstream out(path, std::ios::binary | std::ios::trunc);
+
+        out.write(frequencyPartialMagic, sizeof(frequencyPartialMagic));
+        detail::writeFixed(out, parameters.size());
+        out.write(parameters.data(), parameters.size());
+        detail::writeFixed(out, numOfExperiments);
+        detail::writeFixed(out, first);
+        detail::writeFixed(out, frequencies.size());
+        out.write(reinterpret_cast<const char *>(frequencies.data()), frequencies.size() * sizeof(double));
+
+        if (!out)
+            throw std::runtime_error("frequency partial: cannot write " + path);
+    }
+
+    inline FrequencyPartial FrequencyPartial::load(const string &path)
+    {
+        std::ifstream in(path, std::ios::binary);
+        char magic[sizeof(frequencyPartialMagic)];
+        FrequencyPartial partial;
+
+        if (!in)
+            throw std::runtime_error("frequency partial: cannot open " + path);
+
+        in.read(magic, sizeof(magic));
+        if (!in || !std::equal(magic, magic + sizeof(magic), frequencyPartialMagic))
+            throw std::runtime_error("frequency partial: " + path + " is not a frequency partial");
+
+        partial.parameters.resize(detail::readFixed(in));
+        in.read(partial.parameters.data(), partial.parameters.size());
+        partial.numOfExperiments = detail::readFixed(in);
+        partial.first = detail::readFixed(in);
+        partial.frequencies.resize(detail::readFixed(in));
+        in.read(reinterpret_cast<char *>(partial.frequencies.data()), partial.frequencies.size() * sizeof(double));
+        if (!in || partial.first + partial.frequencies.size() > partial.numOfExperiments)
+            throw std::runtime_error("frequency partial: " + path + " is broken");
+
+        return partial;
+    }
+
+    template <Real R, size_t n, Transformation<R, n> F>
+    FrequencyPartial frequencyOfRandomOrbits(const StaticGGT<R, n, F> &ggt, Torus<R, n> rectBL, Torus<R, n> rectTR, size_t depth,
+                                             size_t numOfExperiments, std::uint64_t seed, Shard shard, const string &parameters)
+    {
+        FrequencyPartial partial;
+
+        partial.parameters = parameters;
+        partial.numOfExperiments = numOfExperiments;
+        partial.first = shard.first(numOfExperiments);
+        partial.frequencies = ggt.frequenciesOfRandomOrbits(rectBL, rectTR, depth, partial.first, shard.last(numOfExperiments) - partial.first, seed);
+
+        return partial;
+    }
+
+    inline FrequencyPartial mergeFrequencies(vector<FrequencyPartial> partials)
+    {
+        FrequencyPartial merged;
+        size_t k;
+
+        if (partials.empty())
+            return merged;
+
+        std::sort(partials.begin(), partials.end(), [](const FrequencyPartial &a, const FrequencyPartial &b)
+                  { return a.first < b.first; });
+
+        merged.parameters = partials[0].parameters;
+        merged.numOfExperiments = partials[0].numOfExperiments;
+        merged.first = partials[0].first;
+        for (k = 0; k < partials.size(); ++k)
+        {
+            if (partials[k].parameters != merged.parameters || partials[k].numOfExperiments != merged.numOfExperiments)
+                throw std::invalid_argument("mergeFrequencies: the partials are of different runs (" + merged.parameters + " / " + partials[k].parameters + ")");
+            if (partials[k].first < merged.first + merged.frequencies.size())
+                throw std::invalid_argument("mergeFrequencies: the partials overlap at the experiment " + std::to_string(partials[k].first));
+            if (partials[k].first > merged.first + merged.frequencies.size())
+                throw std::invalid_argument("mergeFrequencies: the experiments from " + std::to_string(merged.first + merged.frequencies.size()) + " are missing");
+
+            merged.frequencies.insert(merged.frequencies.end(), partials[k].frequencies.begin(), partials[k].frequencies.end());
+        }
+
+        return merged;
+    }
+}
@@ -2,11 +2,45 @@
 
 #include "real.hpp"
 #include "matrix.hpp"
-
-#include <functional>
+#include "util.hpp"
+#include "lowdiscrepancy.hpp"
+#include "instrument.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <concepts>
+#include <cstdint>
+#include <queue>
+#include <random>
+#include <vector>
 
 namespace GaussSim
 {
+    // the value of an integral with its estimated (absolute) error
+    template <Real R>
+    struct IntegrationResult
+    {
+        R value;
+        double error;
+        size_t numOfEvaluations;
+    };
+
+    // the default upper bound of the evaluations of the integrant in integralQMC / integralAdaptive
+    const size_t defaultMaxEvaluations = 1 << 24;
+    // integralAdaptive starts from a grid of (up to) this number of cells per axis,
+    // so that its error estimate is not fooled by an integrant which is (almost) periodic with the period of the whole rectangle
+    const size_t adaptiveInitialDivisions = 8;
+
+    // points in structure-of-arrays layout (defined in batch.hpp, which is included at the end of this header)
+    template <Real R, size_t n>
+    struct TorusBatch;
+
+    // an integrant evaluated on many points at once: integrant(points)[k] = the value at the k-th point
+    template <typename F, typename R, size_t n>
+    concept BatchIntegrant = requires(F f, const TorusBatch<R, n> &points) {
+        { f(points) } -> std::convertible_to<vector<R>>;
+    };
+
     template <Real R, size_t n>
     struct Torus
     {
@@ -21,6 +55,7 @@ namespace GaussSim
         Torus(array<R, n> coor, bool noAdjust) : coordinate(coor), noAdjust(noAdjust) { adjust(); }
         Torus(const Torus<R, n> &torus) : coordinate(torus.coordinate), noAdjust(torus.noAdjust) {}
         Torus(const Torus<R, n> &torus, bool noAdjust) : coordinate(torus.coordinate), noAdjust(noAdjust) {}
+        Torus<R, n> &operator=(const Torus<R, n> &) = default;
 
         void adjust();
         array<R, n> inverse() const;
@@ -53,11 +88,40 @@ namespace GaussSim
         // static functions
 
         // the lebesgue measure of the rectangle with diagonal points a, b
-        static R measure(Torus<R, n> a, Torus<R, n> b);
+        static R measure(Torus<R, n> a, Torus<R, n> b)
+            requires(!isReducedMod1<R>);
 
-        // the integral on the rectangle with diagonal points a, b
+        // the integral on the rectangle with diagonal points a, b (by the midpoint rule)
         // N is the number of partitions (per a direction). As N be greater, the integral is more accurate but the calc speed is slower.
-        static R integral(std::function<R(Torus<R, n>)> integrant, Torus<R, n> a, Torus<R, n> b, size_t N);
+        // (N = 0: 0)
+        // integrant: any callable Torus<R, n> -> R (not wrapped in std::function, so that it can be inlined),
+        // or a BatchIntegrant, which is given the midpoints of up to 4096 cells at once (as a TorusBatch) and can vectorize over them
+        // the cells are summed up in parallel (with OpenMP) by compensated summation, in the order independent of the number of threads
+        template <typename Integrant>
+        static R integral(Integrant integrant, Torus<R, n> a, Torus<R, n> b, size_t N)
+            requires(!isReducedMod1<R>);
+
+        // the integral on the rectangle with diagonal points a, b by randomized quasi-monte carlo
+        // the halton points are shifted by numOfReplicas independent random vectors, and the error is estimated from the spread of the replicas
+        // the number of points is doubled until the error <= tolerance (or the evaluations reach maxEvaluations)
+        template <typename Integrant>
+        static IntegrationResult<R> integralQMC(Integrant integrant, Torus<R, n> a, Torus<R, n> b, double tolerance,
+                                                size_t maxEvaluations = defaultMaxEvaluations, std::uint64_t seed = 0)
+            requires(!isReducedMod1<R>);
+
+        // the integral on the rectangle with diagonal points a, b by adaptive subdivision
+        // the rectangle is first divided into adaptiveInitialDivisions cells per axis (fewer if maxEvaluations is too small for them),
+        // then the cell with the largest error estimate is bisected (along the axis where the integrant varies most)
+        // until the total error <= tolerance (or the evaluations reach maxEvaluations)
+        template <typename Integrant>
+        static IntegrationResult<R> integralAdaptive(Integrant integrant, Torus<R, n> a, Torus<R, n> b, double tolerance,
+                                                     size_t maxEvaluations = defaultMaxEvaluations)
+            requires(!isReducedMod1<R>);
+
+    protected:
+        // the side lengths of the rectangle with diagonal points a, b (from a to b in the positive direction)
+        static array<R, n> sideLengths(Torus<R, n> a, Torus<R, n> b)
+            requires(!isReducedMod1<R>);
     };
 
     template <Real R, size_t n>
@@ -66,6 +130,8 @@ namespace GaussSim
         if (noAdjust)
             return;
 
+        GAUSSSIM_COUNT(IC_ADJUST, 1);
+
         int i;
         for (i = 0; i < n; ++i)
         {
@@ -105,6 +171,8 @@ namespace GaussSim
         }
 
         adjust();
+
+        return *this;
     }
 
     template <Real R, size_t n>
@@ -117,6 +185,8 @@ namespace GaussSim
         }
 
         adjust();
+
+        return *this;
     }
 
     template <Real R, size_t n>
@@ -143,6 +213,8 @@ namespace GaussSim
         }
 
         adjust();
+
+        return *this;
     }
 
     template <Real R, size_t n>
@@ -155,6 +227,8 @@ namespace GaussSim
         }
 
         adjust();
+
+        return *this;
     }
 
     template <Real R, size_t n>
@@ -177,10 +251,13 @@ namespace GaussSim
         int i;
         for (i = 0; i < n; ++i)
         {
-            coordinate[i] *= m;
+            // not *=, so that the exact product with an integer is used (see FixedPoint64)
+            coordinate[i] = coordinate[i] * m;
         }
 
         adjust();
+
+        return *this;
     }
 
     template <Real R, size_t n>
@@ -191,6 +268,7 @@ namespace GaussSim
     }
 
     // toral homomorphism
+    // (see batch.hpp for the version applied to many points at once)
 
     template <Real R, size_t n, size_t m>
     const Torus<R, m> operator*(Matrix<int, m, n> mat, Torus<R, n> tor)
@@ -212,6 +290,7 @@ namespace GaussSim
 
     template <Real R, size_t n>
     R Torus<R, n>::measure(Torus<R, n> a, Torus<R, n> b)
+        requires(!isReducedMod1<R>)
     {
         R area = static_cast<R>(1);
         int i;
@@ -231,71 +310,364 @@ namespace GaussSim
     }
 
     template <Real R, size_t n>
-    R Torus<R, n>::integral(std::function<R(Torus<R, n>)> integrant, Torus<R, n> a, Torus<R, n> b, size_t N)
+    template <typename Integrant>
+    R Torus<R, n>::integral(Integrant integrant, Torus<R, n> a, Torus<R, n> b, size_t N)
+        requires(!isReducedMod1<R>)
     {
-        R value = static_cast<R>(0);
-        Torus<R, n> searchingRectBL, searchingRectTR; // bottom-left, top-right
-        array<size_t, n> searchingIndex;
-        int i;
+        GAUSSSIM_PHASE(IP_INTEGRAL);
+
+        const size_t chunkSize = 4096; // the number of cells summed up by a task
+        array<R, n> width = sideLengths(a, b);
+        array<R, n> halfWidth;      // the half width of the cells
+        R area = static_cast<R>(1); // the measure of a cell
+        size_t numOfCells = 1;
+        size_t i;
 
-        searchingIndex.fill(0);
+        // no cells (the empty sum)
+        if (N == 0)
+            return static_cast<R>(0);
 
-        std::function<void(void)> __SpecifyPoints = [&]()
+        a.adjust();
+
+        for (i = 0; i < n; ++i)
         {
-            for (i = 0; i < n; ++i)
+            halfWidth[i] = width[i] / static_cast<R>(static_cast<double>(2 * N));
+            area = area * (width[i] / static_cast<R>(static_cast<double>(N)));
+            numOfCells *= N;
+        }
+
+        // the i-th coordinate of the midpoint of the cells whose i-th index is k
+        auto midpointCoordinate = [&](size_t i, size_t k)
+        {
+            return MOD1<R>(a[i] + halfWidth[i] * static_cast<R>(static_cast<double>(2 * k + 1)));
+        };
+
+        const size_t numOfChunks = (numOfCells + chunkSize - 1) / chunkSize;
+        vector<R> chunkSums(numOfChunks, static_cast<R>(0));
+        util::CompensatedSum<R> value;
+        size_t c;
+
+#pragma omp parallel for schedule(static)
+        for (c = 0; c < numOfChunks; ++c)
+        {
+            size_t first = c * chunkSize, last = std::min(first + chunkSize, numOfCells);
+            size_t rest = first, k, j;
+            array<size_t, n> index; // index[0] changes fastest
+            array<R, n> coordinate;  // the midpoint of the current cell
+            TorusBatch<R, n> midpoints(last - first);
+            util::CompensatedSum<R> sum;
+
+            for (j = 0; j < n; ++j)
             {
-                searchingRectBL[i] =
-                    (static_cast<R>(b[i]) * searchingIndex[i] + a[i] * static_cast<R>((N - searchingIndex[i]))) / static_cast<R>(N);
-                searchingRectTR[i] =
-                    (static_cast<R>(b[i]) * (searchingIndex[i] + 1) + a[i] * static_cast<R>((N - searchingIndex[i] - 1))) / static_cast<R>(N);
+                index[j] = rest % N;
+                rest /= N;
+                coordinate[j] = midpointCoordinate(j, index[j]);
             }
-            searchingRectBL.adjust();
-            searchingRectTR.adjust();
-        };
 
-        std::function<void(void)> __CalcAprxIntegralOnRect = [&]()
+            // the midpoints of the cells of the chunk
+            for (k = 0; k < last - first; ++k)
+            {
+                for (j = 0; j < n; ++j)
+                {
+                    midpoints.lanes[j][k] = coordinate[j];
+                }
+
+                // move to the next cell
+                for (j = 0; j < n; ++j)
+                {
+                    if (++index[j] < N)
+                    {
+                        coordinate[j] = midpointCoordinate(j, index[j]);
+                        break;
+                    }
+                    index[j] = 0;
+                    coordinate[j] = midpointCoordinate(j, 0);
+                }
+            }
+
+            if constexpr (std::invocable<Integrant &, Torus<R, n> &>)
+            {
+                Torus<R, n> midpoint;
+                for (k = 0; k < last - first; ++k)
+                {
+                    for (j = 0; j < n; ++j)
+                    {
+                        midpoint.coordinate[j] = midpoints.lanes[j][k];
+                    }
+                    sum.add(integrant(midpoint));
+                }
+            }
+            else
+            {
+                static_assert(BatchIntegrant<Integrant, R, n>, "the integrant must be callable on Torus<R, n> or on TorusBatch<R, n>");
+
+                vector<R> values = integrant(static_cast<const TorusBatch<R, n> &>(midpoints));
+                for (k = 0; k < last - first; ++k)
+                {
+                    sum.add(values[k]);
+                }
+            }
+
+            chunkSums[c] = sum.value();
+        }
+
+        for (c = 0; c < numOfChunks; ++c)
+        {
+            value.add(chunkSums[c]);
+        }
+
+        return value.value() * area;
+    }
+
+    template <Real R, size_t n>
+    array<R, n> Torus<R, n>::sideLengths(Torus<R, n> a, Torus<R, n> b)
+        requires(!isReducedMod1<R>)
+    {
+        array<R, n> width;
+        size_t i;
+
+        a.adjust();
+        b.adjust();
+
+        for (i = 0; i < n; ++i)
+        {
+            width[i] = (a[i] <= b[i]) ? b[i] - a[i] : b[i] + 1 - a[i];
+        }
+
+        return width;
+    }
+
+    template <Real R, size_t n>
+    template <typename Integrant>
+    IntegrationResult<R> Torus<R, n>::integralQMC(Integrant integrant, Torus<R, n> a, Torus<R, n> b, double tolerance, size_t maxEvaluations, std::uint64_t seed)
+        requires(!isReducedMod1<R>)
+    {
+        GAUSSSIM_PHASE(IP_INTEGRAL);
+
+        const size_t numOfReplicas = 16;
+        const HaltonSequence<n> halton;
+        array<R, n> width = sideLengths(a, b);
+        R area = static_cast<R>(1);
+        array<array<double, n>, numOfReplicas> shifts;
+        vector<util::CompensatedSum<R>> sums(numOfReplicas);
+        std::mt19937_64 engine(seed);
+        std::uniform_real_distribution<double> rndm(0, 1);
+        IntegrationResult<R> result;
+        size_t numOfPoints = 0, target = 64;
+        size_t i, r;
+
+        a.adjust();
+
+        for (i = 0; i < n; ++i)
+        {
+            area = area * width[i];
+        }
+        for (r = 0; r < numOfReplicas; ++r)
         {
-            R midvalue, area;
-            Torus<R, n> midpoint;
-            int i;
             for (i = 0; i < n; ++i)
             {
-                midpoint[i] = (searchingRectBL[i] + searchingRectTR[i]) / 2;
+                shifts[r][i] = rndm(engine);
+            }
+        }
+
+        while (true)
+        {
+            // add the points numOfPoints, ..., target - 1 to every replica
+#pragma omp parallel for schedule(static)
+            for (r = 0; r < numOfReplicas; ++r)
+            {
+                Torus<R, n> x;
+                array<double, n> h;
+                double u;
+                size_t k, j;
+                for (k = numOfPoints; k < target; ++k)
+                {
+                    h = halton.point(k);
+                    for (j = 0; j < n; ++j)
+                    {
+                        u = h[j] + shifts[r][j];
+                        if (u >= 1)
+                            u -= 1;
+                        x.coordinate[j] = MOD1<R>(a.coordinate[j] + width[j] * static_cast<R>(u));
+                    }
+                    sums[r].add(integrant(x));
+                }
+            }
+            numOfPoints = target;
+
+            // the replicas are independent estimates of the integral
+            util::CompensatedSum<R> total;
+            double mean = 0, variance = 0, estimate;
+            for (r = 0; r < numOfReplicas; ++r)
+            {
+                total.add(sums[r].value());
+                mean += static_cast<double>(sums[r].value()) / numOfPoints;
             }
+            mean /= numOfReplicas;
+            for (r = 0; r < numOfReplicas; ++r)
+            {
+                estimate = static_cast<double>(sums[r].value()) / numOfPoints;
+                variance += (estimate - mean) * (estimate - mean);
+            }
+            variance /= numOfReplicas - 1;
+
+            result.value = total.value() / static_cast<R>(static_cast<double>(numOfPoints * numOfReplicas)) * area;
+            result.error = std::sqrt(variance / numOfReplicas) * std::abs(static_cast<double>(area));
+            result.numOfEvaluations = numOfPoints * numOfReplicas;
 
-            midvalue = integrant(midpoint);
-            area = Torus<R, n>::measure(searchingRectBL, searchingRectTR);
+            if (result.error <= tolerance || 2 * result.numOfEvaluations > maxEvaluations)
+                break;
+            target *= 2;
+        }
 
-            value = value + midvalue * area;
+        return result;
+    }
+
+    template <Real R, size_t n>
+    template <typename Integrant>
+    IntegrationResult<R> Torus<R, n>::integralAdaptive(Integrant integrant, Torus<R, n> a, Torus<R, n> b, double tolerance, size_t maxEvaluations)
+        requires(!isReducedMod1<R>)
+    {
+        GAUSSSIM_PHASE(IP_INTEGRAL);
+
+        // a cell in the coordinates relative to a
+        struct Cell
+        {
+            array<R, n> center, halfWidth;
+            R centerValue;               // the integrant at the center
+            R value;                     // the estimated integral on the cell
+            double error;                // the estimated error of value
+            size_t splitAxis;            // the axis along which the integrant varies most
+            array<R, 2> halfCenterValue; // the integrant at the centers of the halves split along splitAxis
+
+            bool operator<(const Cell &cell) const { return error < cell.error; }
         };
 
-        std::function<void(void)>
-            __NextRect = [&]()
+        std::priority_queue<Cell> cells;
+        IntegrationResult<R> result;
+        util::CompensatedSum<R> value;
+        double totalError;
+        array<R, n> sides;
+        size_t divisions, numOfInitialCells, index, i, k, side;
+
+        a.adjust();
+        result.numOfEvaluations = 0;
+
+        auto evaluate = [&](const array<R, n> &relative)
         {
-            ++searchingIndex[0];
-            for (i = 0; i < n - 1; ++i)
+            Torus<R, n> x;
+            size_t j;
+            for (j = 0; j < n; ++j)
             {
-                if (searchingIndex[i] == N)
+                x.coordinate[j] = MOD1<R>(a.coordinate[j] + relative[j]);
+            }
+            ++result.numOfEvaluations;
+            return static_cast<R>(integrant(x));
+        };
+
+        // compare the midpoint rule on the cell with the midpoint rules on its halves along each axis
+        auto estimate = [&](Cell &cell)
+        {
+            R volume = static_cast<R>(1), midpointRule, refined, left, right;
+            array<R, n> point;
+            double difference;
+            size_t j;
+
+            for (j = 0; j < n; ++j)
+            {
+                volume = volume * cell.halfWidth[j] * 2;
+            }
+            midpointRule = volume * cell.centerValue;
+
+            cell.error = -1;
+            for (j = 0; j < n; ++j)
+            {
+                point = cell.center;
+                point[j] = cell.center[j] - cell.halfWidth[j] / 2;
+                left = evaluate(point);
+                point[j] = cell.center[j] + cell.halfWidth[j] / 2;
+                right = evaluate(point);
+
+                refined = volume * (left + right) / 2;
+                difference = std::abs(static_cast<double>(refined - midpointRule));
+                if (difference > cell.error)
                 {
-                    searchingIndex[i] = 0;
-                    ++searchingIndex[i + 1];
+                    cell.error = difference;
+                    cell.value = refined;
+                    cell.splitAxis = j;
+                    cell.halfCenterValue = {left, right};
                 }
             }
         };
 
-        while (searchingIndex[n - 1] < N)
+        // the initial grid (a cell costs 2n + 1 evaluations)
+        for (divisions = adaptiveInitialDivisions; divisions > 1; --divisions)
         {
-            // specify the diagonal points
-            __SpecifyPoints();
+            numOfInitialCells = 1;
+            for (i = 0; i < n; ++i)
+            {
+                numOfInitialCells *= divisions;
+            }
+            if (numOfInitialCells * (2 * n + 1) <= maxEvaluations)
+                break;
+        }
+        numOfInitialCells = 1;
+        for (i = 0; i < n; ++i)
+        {
+            numOfInitialCells *= divisions;
+        }
+
+        sides = sideLengths(a, b);
+        totalError = 0;
+        for (k = 0; k < numOfInitialCells; ++k)
+        {
+            Cell cell;
+            index = k;
+            for (i = 0; i < n; ++i)
+            {
+                cell.halfWidth[i] = sides[i] / static_cast<R>(static_cast<double>(2 * divisions));
+                cell.center[i] = cell.halfWidth[i] * static_cast<R>(static_cast<double>(2 * (index % divisions) + 1));
+                index /= divisions;
+            }
+            cell.centerValue = evaluate(cell.center);
+            estimate(cell);
+            totalError += cell.error;
+            cells.push(cell);
+        }
 
-            // calculate the approximated integral on the rectangle and add to value
-            __CalcAprxIntegralOnRect();
+        // bisecting a cell costs 4n evaluations
+        while (totalError > tolerance && result.numOfEvaluations + 4 * n <= maxEvaluations)
+        {
+            Cell cell = cells.top();
+            cells.pop();
+            totalError -= cell.error;
+
+            for (side = 0; side < 2; ++side)
+            {
+                Cell half = cell;
+                half.halfWidth[cell.splitAxis] = cell.halfWidth[cell.splitAxis] / 2;
+                half.center[cell.splitAxis] = (side == 0) ? cell.center[cell.splitAxis] - half.halfWidth[cell.splitAxis]
+                                                          : cell.center[cell.splitAxis] + half.halfWidth[cell.splitAxis];
+                half.centerValue = cell.halfCenterValue[side];
+                estimate(half);
+                totalError += half.error;
+                cells.push(half);
+            }
+        }
 
-            // move to the next rectangle
-            __NextRect();
+        // sum up the cells (the error is also summed again to cancel the rounding of the updates above)
+        totalError = 0;
+        while (!cells.empty())
+        {
+            value.add(cells.top().value);
+            totalError += cells.top().error;
+            cells.pop();
         }
 
-        return value;
+        result.value = value.value();
+        result.error = totalError;
+
+        return result;
     }
 
     template <size_t n>
@@ -318,3 +690,5 @@ namespace GaussSim
         }
     }
 }
+
+#include "batch.hpp"
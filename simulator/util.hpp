@@ -21,5 +21,39 @@ namespace GaussSim
 
             return res;
         }
+
+        // compensated (kahan-babuska-neumaier) summation
+        // the rounding error of each addition is accumulated separately, so the error does not grow with the number of terms
+        template <typename T>
+        class CompensatedSum
+        {
+        protected:
+            T sum = static_cast<T>(0);
+            T compensation = static_cast<T>(0);
+
+        public:
+            void add(T x);
+            T value() const { return sum + compensation; }
+
+            CompensatedSum<T> &operator+=(T x)
+            {
+                add(x);
+                return *this;
+            }
+        };
+
+        template <typename T>
+        void CompensatedSum<T>::add(T x)
+        {
+            T t = sum + x;
+            T absSum = (sum < 0) ? -sum : sum;
+            T absX = (x < 0) ? -x : x;
+
+            if (absSum >= absX)
+                compensation = compensation + ((sum - t) + x);
+            else
+                compensation = compensation + ((x - t) + sum);
+            sum = t;
+        }
     }
 }
\ No newline at end of file